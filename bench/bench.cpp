@@ -0,0 +1,277 @@
+// Throughput of utf::conversion functions on synthetic corpora.
+// Every direction is measured on every corpus, for short strings and large buffers, with and without comply_with_standard.
+// Counting and truncation of code points are measured on large buffers.
+// Byte streams in the foreign byte order are measured on large buffers, to compare with the native directions.
+// Error policies are measured on dirty input, which has an error every few code points.
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <utility>
+
+namespace {
+    constexpr std::size_t small_size = 64;
+    constexpr std::size_t large_size = std::size_t(1) << 20;
+
+    enum class corpus_e { ascii, latin1, cjk, emoji, mixed, malformed };
+
+    const char* corpus_name(corpus_e corpus) {
+        switch (corpus) {
+        case corpus_e::ascii:     return "ascii";
+        case corpus_e::latin1:    return "latin1";
+        case corpus_e::cjk:       return "cjk";
+        case corpus_e::emoji:     return "emoji";
+        case corpus_e::mixed:     return "mixed";
+        case corpus_e::malformed: return "malformed";
+        }
+        return "";
+    }
+
+    // Picks a code point, in roughly the proportions found in real text of each kind.
+    char32_t random_code_point(corpus_e corpus, std::mt19937& rng) {
+        const auto in = [&rng](char32_t first, char32_t last) {
+            return static_cast<char32_t>(std::uniform_int_distribution<uint32_t>(first, last)(rng));
+        };
+        const uint32_t percent = rng() % 100;
+
+        switch (corpus) {
+        case corpus_e::ascii:
+            return in(0x20, 0x7E);
+        case corpus_e::latin1:
+            return percent < 70 ? in(0x20, 0x7E) : in(0xA0, 0xFF);
+        case corpus_e::cjk:
+            return percent < 10 ? in(0x20, 0x7E) : in(0x4E00, 0x9FFF);
+        case corpus_e::emoji:
+            return percent < 20 ? in(0x20, 0x7E) : in(0x1F300, 0x1FAFF);
+        default:
+            return percent < 40 ? in(0x20, 0x7E)
+                 : percent < 60 ? in(0xA0, 0x7FF)
+                 : percent < 85 ? in(0x800, 0xD7FF)
+                 : in(0x10000, 0x10FFFF);
+        }
+    }
+
+    std::u32string make_code_points(corpus_e corpus, std::size_t size) {
+        std::mt19937 rng(static_cast<uint32_t>(corpus) * 7919 + static_cast<uint32_t>(size));
+        std::u32string code_points(size, 0);
+        for (char32_t& code_point : code_points) {
+            code_point = random_code_point(corpus, rng);
+        }
+        return code_points;
+    }
+
+    // Encodes the corpus in the given encoding. The malformed corpus gets a single error in the middle, so the time
+    // covers both the conversion of the valid part and the rejection.
+    template <typename char_type>
+    std::basic_string<char_type> make_corpus(corpus_e corpus, std::size_t size) {
+        const std::u32string code_points = make_code_points(corpus, size);
+        std::basic_string<char_type> encoded;
+
+        if constexpr (sizeof(char_type) == sizeof(char32_t)) {
+            encoded = code_points;
+        }
+        else {
+            std::basic_string<char_type> result;
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                utf::conversion::utf32_to_utf8(code_points, result);
+            }
+            else {
+                utf::conversion::utf32_to_utf16(code_points, result);
+            }
+            encoded = std::move(result);
+        }
+
+        if (corpus == corpus_e::malformed && !encoded.empty()) {
+            // UTF-8: invalid byte, UTF-16: unpaired low surrogate (an error in strict mode only), UTF-32: out of range
+            char_type& middle = encoded[encoded.size() / 2];
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                middle = 0xFF;
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                middle = 0xDC00;
+            }
+            else {
+                middle = 0x110000;
+            }
+        }
+        return encoded;
+    }
+
+    template <typename from_type, typename to_type>
+    void convert_to_string(const std::basic_string<from_type>& input, std::basic_string<to_type>& output, bool comply_with_standard) {
+        using namespace utf::conversion;
+
+        if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+            if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                benchmark::DoNotOptimize(utf8_to_utf16(input, output, comply_with_standard));
+            }
+            else {
+                benchmark::DoNotOptimize(utf8_to_utf32(input, output, comply_with_standard));
+            }
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+            if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                benchmark::DoNotOptimize(utf16_to_utf8(input, output, comply_with_standard));
+            }
+            else {
+                benchmark::DoNotOptimize(utf16_to_utf32(input, output, comply_with_standard));
+            }
+        }
+        else {
+            if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                benchmark::DoNotOptimize(utf32_to_utf8(input, output, comply_with_standard));
+            }
+            else {
+                benchmark::DoNotOptimize(utf32_to_utf16(input, output, comply_with_standard));
+            }
+        }
+    }
+
+    template <typename from_type, typename to_type>
+    void register_direction(const char* direction) {
+        for (const corpus_e corpus : { corpus_e::ascii, corpus_e::latin1, corpus_e::cjk, corpus_e::emoji, corpus_e::mixed, corpus_e::malformed }) {
+            for (const std::size_t size : { small_size, large_size }) {
+                for (const bool comply_with_standard : { false, true }) {
+                    const std::string name = std::string(direction) + "/" + corpus_name(corpus) + (size == small_size ? "/small" : "/large")
+                                           + (comply_with_standard ? "/strict" : "/lenient");
+
+                    benchmark::RegisterBenchmark(name.c_str(), [corpus, size, comply_with_standard](benchmark::State& state) {
+                        const std::basic_string<from_type> input = make_corpus<from_type>(corpus, size);
+                        std::basic_string<to_type> output;
+
+                        for (auto _ : state) {
+                            convert_to_string(input, output, comply_with_standard);
+                            benchmark::ClobberMemory();
+                        }
+
+                        const auto iterations = static_cast<double>(state.iterations());
+                        state.SetBytesProcessed(static_cast<int64_t>(iterations * input.size() * sizeof(from_type)));
+                        state.counters["code_points"] = benchmark::Counter(iterations * size, benchmark::Counter::kIsRate);
+                    });
+                }
+            }
+        }
+    }
+
+    // counting and truncation in the middle of the string, on the encodings the storage layer keeps
+    template <typename char_type>
+    void register_code_points(const char* encoding) {
+        for (const corpus_e corpus : { corpus_e::ascii, corpus_e::cjk, corpus_e::mixed }) {
+            const std::string name = std::string(encoding) + "/" + corpus_name(corpus);
+
+            benchmark::RegisterBenchmark(("count_code_points/" + name).c_str(), [corpus](benchmark::State& state) {
+                const std::basic_string<char_type> input = make_corpus<char_type>(corpus, large_size);
+                for (auto _ : state) {
+                    benchmark::DoNotOptimize(utf::count_code_points(input));
+                }
+                state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size() * sizeof(char_type)));
+            });
+            benchmark::RegisterBenchmark(("truncate_to_code_points/" + name).c_str(), [corpus](benchmark::State& state) {
+                const std::basic_string<char_type> input = make_corpus<char_type>(corpus, large_size);
+                for (auto _ : state) {
+                    benchmark::DoNotOptimize(utf::truncate_to_code_points(input, large_size / 2));
+                }
+                state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size() * sizeof(char_type) / 2));
+            });
+        }
+    }
+
+    // conversion of byte streams in the byte order opposite to the native one
+    template <typename from_type, typename to_type>
+    void register_foreign_order(const char* direction) {
+        const utf::conversion::byte_order_e foreign_order = utf::conversion::native_byte_order == utf::conversion::byte_order_e::little_endian
+                                                          ? utf::conversion::byte_order_e::big_endian : utf::conversion::byte_order_e::little_endian;
+
+        for (const corpus_e corpus : { corpus_e::ascii, corpus_e::cjk, corpus_e::mixed }) {
+            const std::string name = std::string(direction) + "/swapped/" + corpus_name(corpus) + "/large";
+
+            benchmark::RegisterBenchmark(name.c_str(), [corpus, foreign_order](benchmark::State& state) {
+                std::basic_string<from_type> units = make_corpus<from_type>(corpus, large_size);
+                for (from_type& unit : units) {
+                    if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                        unit = static_cast<from_type>(((unit & 0xFF) << 8) | (unit >> 8));
+                    }
+                    else {
+                        unit = static_cast<from_type>(((unit & 0xFF) << 24) | ((unit & 0xFF00) << 8) | ((unit >> 8) & 0xFF00) | (unit >> 24));
+                    }
+                }
+                const std::string input(reinterpret_cast<const char*>(units.data()), units.size() * sizeof(from_type));
+                std::basic_string<to_type> output;
+
+                for (auto _ : state) {
+                    if constexpr (sizeof(from_type) == sizeof(char16_t) && sizeof(to_type) == sizeof(char8_t)) {
+                        benchmark::DoNotOptimize(utf::conversion::utf16_to_utf8(input, foreign_order, output));
+                    }
+                    else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                        benchmark::DoNotOptimize(utf::conversion::utf16_to_utf32(input, foreign_order, output));
+                    }
+                    else if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                        benchmark::DoNotOptimize(utf::conversion::utf32_to_utf8(input, foreign_order, output));
+                    }
+                    else {
+                        benchmark::DoNotOptimize(utf::conversion::utf32_to_utf16(input, foreign_order, output));
+                    }
+                    benchmark::ClobberMemory();
+                }
+                state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+            });
+        }
+    }
+
+    // error policies on input with an error every 16 code points on average
+    template <typename from_type, typename to_type, utf::conversion::error_policy_e policy>
+    void register_policy(const char* direction, const char* policy_name) {
+        const std::string name = std::string(direction) + "/dirty/large/" + policy_name;
+
+        benchmark::RegisterBenchmark(name.c_str(), [](benchmark::State& state) {
+            std::basic_string<from_type> input = make_corpus<from_type>(corpus_e::mixed, large_size);
+            std::mt19937 rng(42);
+            for (std::size_t i = rng() % 32; i < input.size(); i += 1 + rng() % 32) {
+                // UTF-8: stray continuation byte, UTF-16: lone low surrogate, UTF-32: surrogate
+                input[i] = static_cast<from_type>(sizeof(from_type) == sizeof(char8_t) ? 0x80 : 0xDC00);
+            }
+            std::basic_string<to_type> output;
+
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(utf::conversion::convert<policy>(std::basic_string_view<from_type>(input), output));
+                benchmark::ClobberMemory();
+            }
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size() * sizeof(from_type)));
+        });
+    }
+
+    template <typename from_type, typename to_type>
+    void register_policies(const char* direction) {
+        register_policy<from_type, to_type, utf::conversion::error_policy_e::replace>(direction, "replace");
+        register_policy<from_type, to_type, utf::conversion::error_policy_e::skip>(direction, "skip");
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    register_direction<char8_t, char16_t>("utf8_to_utf16");
+    register_direction<char8_t, char32_t>("utf8_to_utf32");
+    register_direction<char16_t, char8_t>("utf16_to_utf8");
+    register_direction<char16_t, char32_t>("utf16_to_utf32");
+    register_direction<char32_t, char8_t>("utf32_to_utf8");
+    register_direction<char32_t, char16_t>("utf32_to_utf16");
+    register_code_points<char8_t>("utf8");
+    register_code_points<char16_t>("utf16");
+    register_foreign_order<char16_t, char8_t>("utf16_to_utf8");
+    register_foreign_order<char16_t, char32_t>("utf16_to_utf32");
+    register_foreign_order<char32_t, char8_t>("utf32_to_utf8");
+    register_foreign_order<char32_t, char16_t>("utf32_to_utf16");
+    register_policies<char8_t, char16_t>("utf8_to_utf16");
+    register_policies<char16_t, char8_t>("utf16_to_utf8");
+    register_policies<char32_t, char8_t>("utf32_to_utf8");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
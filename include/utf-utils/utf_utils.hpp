@@ -15,18 +15,30 @@
  */
 
 // Standard library
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstddef>
+#include <iterator>
 #include <string>
 #include <vector>
 
-#if __cplusplus < 202002L // < c++20
+#if !defined(__cpp_char8_t) // < c++20
     /**
-     * @brief Typedef for char8_t type. Used if and only if C++ standard is less than C++20
+     * @brief Typedef for char8_t type. Used if and only if the compiler has no built-in char8_t (C++ standard less than C++20)
      */
     using char8_t = unsigned char;
 #endif
 
+// The compiled library takes and returns char8_t, so it only links with code that has the same char8_t
+#if !defined(UTFUTILS_HEADER_ONLY) && defined(UTFUTILS_LIBRARY_CHAR8_T) && UTFUTILS_LIBRARY_CHAR8_T != defined(__cpp_char8_t)
+#   if UTFUTILS_LIBRARY_CHAR8_T
+#       error "utf-utils was built for C++20, build this code for C++20 as well (or use the header-only library)"
+#   else
+#       error "utf-utils was built for C++17, build this code for C++17 as well (or use the header-only library)"
+#   endif
+#endif
+
 //----------------------------------------------------INTERFACE----------------------------------------------------//
 
 /**
@@ -44,11 +56,63 @@ namespace utf {
          * @remark Refer to conversion functions' respected documentation for info on #status_e::non_standard_encoding value.
          */
         enum class status_e : int8_t {
+            output_too_small = -2, /**< The output buffer can not hold the whole converted string. */
             non_standard_encoding = -1, /**< The encoding is not standard-compliant. */
             undefined_error, /**< There was some error during conversion. */
             success /**< Everything went smoothly. */
         };
 
+        /**
+         * @brief Describes the outcome of conversion into a caller-supplied buffer.
+         */
+        struct conversion_result_t {
+            status_e status; /**< #status_e::success if the whole string was converted, the reason of failure otherwise. */
+            std::size_t read; /**< Number of input code units converted. On failure this is the offset of the sequence that was not converted. */
+            std::size_t written; /**< Number of code units written to the output buffer. */
+            std::size_t replacements = 0; /**< Number of ill-formed sequences replaced or skipped, see #error_policy_e. */
+        };
+
+        /**
+         * @brief Defines what conversion does with ill-formed input.
+         * @remarks
+         * Ill-formed input is invalid UTF-8, code points greater than @c U+10FFFF and surrogates which are not a part of
+         * a pair (including surrogates encoded in UTF-8 and UTF-32). Each maximal subpart of an ill-formed UTF-8 sequence
+         * counts as one error, as the Unicode standard recommends (U+FFFD Substitution of Maximal Subparts).
+         */
+        enum class error_policy_e : uint8_t {
+            strict, /**< Stop at the first error, as with @c comply_with_standard set to @c true. */
+            replace, /**< Replace each error with constants::replacement_character. */
+            skip, /**< Drop each error from the output. */
+            pass_through /**< Keep lone surrogates (WTF-8) and stop at other errors, as with @c comply_with_standard set to @c false. */
+        };
+
+        /**
+         * @brief Tunes multi-threaded conversion.
+         */
+        struct parallel_options_t {
+            std::size_t thread_count = 0; /**< Maximum number of threads (including the calling one). @c 0 means the number of hardware threads. */
+            std::size_t grain_size = std::size_t(1) << 20; /**< Number of input code units each thread converts at a time. */
+            std::size_t threshold = std::size_t(1) << 22; /**< Strings shorter than this (in code units) are converted by the calling thread only. */
+        };
+
+        /**
+         * @brief Defines the order of bytes in code units of UTF-16 and UTF-32 byte streams.
+         */
+        enum class byte_order_e : uint8_t {
+            little_endian, /**< The least significant byte goes first (UTF-16LE, UTF-32LE). */
+            big_endian /**< The most significant byte goes first (UTF-16BE, UTF-32BE). */
+        };
+
+        /**
+         * @brief Byte order of the platform, the one of @c char16_t and @c char32_t strings.
+         */
+        constexpr byte_order_e native_byte_order =
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            byte_order_e::big_endian;
+#else
+            byte_order_e::little_endian;
+#endif
+
         /**
          * @addtogroup conv_funcs Conversion Functions
          * Functions used to convert between Unicode encodings.
@@ -68,7 +132,7 @@ namespace utf {
          * convert "characters" in this range, though it is not recommended. By default the conversion is not strict. If you opt in to enable it
          * you also must be able to handle #status_e::non_standard_encoding return value separately.
          */
-        status_e utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard);
+        status_e utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard = false);
         /**
          * @brief This function converts UTF-8 string to UTF-32 string.
          * 
@@ -82,7 +146,7 @@ namespace utf {
          * convert "characters" in this range, though it is not recommended. By default the conversion is not strict. If you opt in to enable it
          * you also must be able to handle #status_e::non_standard_encoding return value separately.
          */
-        status_e utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard);
+        status_e utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard = false);
 
         /**
          * @brief This function converts UTF-16 string to UTF-8 string.
@@ -97,7 +161,7 @@ namespace utf {
          * convert "characters" in this range, though it is not recommended. By default the conversion is not strict. If you opt in to enable it
          * you also must be able to handle #status_e::non_standard_encoding return value separately.
          */
-        status_e utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard);
+        status_e utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard = false);
 
         /**
          * @brief This function converts UTF-16 string to UTF-32 string.
@@ -112,7 +176,7 @@ namespace utf {
          * convert "characters" in this range, though it is not recommended. By default the conversion is not strict. If you opt in to enable it
          * you also must be able to handle #status_e::non_standard_encoding return value separately.
          */
-        status_e utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard);
+        status_e utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard = false);
 
         /**
          * @brief This function converts UTF-32 string to UTF-8 string.
@@ -127,9 +191,9 @@ namespace utf {
          * convert "characters" in this range, though it is not recommended. By default the conversion is not strict. If you opt in to enable it
          * you also must be able to handle #status_e::non_standard_encoding return value separately.
          */
-        status_e utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard);
+        status_e utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard = false);
         /**
-         * @brief This function converts UTF-32 string to UTF-8 string.
+         * @brief This function converts UTF-32 string to UTF-16 string.
          * 
          * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
          * @param[out] utf16_s reference to a string which will hold converted string.
@@ -141,19 +205,549 @@ namespace utf {
          * convert "characters" in this range, though it is not recommended. By default the conversion is not strict. If you opt in to enable it
          * you also must be able to handle #status_e::non_standard_encoding return value separately.
          */
-        status_e utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard);
+        status_e utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard = false);
+
+        /**
+         * @brief This function converts UTF-8 string to UTF-16 string stored in a caller-supplied buffer.
+         * 
+         * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+         * @param[out] utf16_buffer pointer to a buffer which will hold converted string.
+         * @param[in] utf16_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Nothing is allocated. If the buffer is too small the function converts as much as fits and returns #status_e::output_too_small,
+         * so the conversion can be continued from conversion_result_t::read offset. Use utf::length::utf16_from_utf8() to find out
+         * the size of the buffer needed. Refer to the overload returning @c std::basic_string for details on @p comply_with_standard.
+         */
+        conversion_result_t utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, char16_t* utf16_buffer, std::size_t utf16_capacity, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-8 string to UTF-32 string stored in a caller-supplied buffer.
+         * 
+         * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+         * @param[out] utf32_buffer pointer to a buffer which will hold converted string.
+         * @param[in] utf32_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Nothing is allocated. If the buffer is too small the function converts as much as fits and returns #status_e::output_too_small,
+         * so the conversion can be continued from conversion_result_t::read offset. Use utf::length::utf32_from_utf8() to find out
+         * the size of the buffer needed. Refer to the overload returning @c std::basic_string for details on @p comply_with_standard.
+         */
+        conversion_result_t utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, char32_t* utf32_buffer, std::size_t utf32_capacity, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-16 string to UTF-8 string stored in a caller-supplied buffer.
+         * 
+         * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+         * @param[out] utf8_buffer pointer to a buffer which will hold converted string.
+         * @param[in] utf8_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Nothing is allocated. If the buffer is too small the function converts as much as fits and returns #status_e::output_too_small,
+         * so the conversion can be continued from conversion_result_t::read offset. Use utf::length::utf8_from_utf16() to find out
+         * the size of the buffer needed. Refer to the overload returning @c std::basic_string for details on @p comply_with_standard.
+         */
+        conversion_result_t utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, char8_t* utf8_buffer, std::size_t utf8_capacity, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-16 string to UTF-32 string stored in a caller-supplied buffer.
+         * 
+         * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+         * @param[out] utf32_buffer pointer to a buffer which will hold converted string.
+         * @param[in] utf32_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Nothing is allocated. If the buffer is too small the function converts as much as fits and returns #status_e::output_too_small,
+         * so the conversion can be continued from conversion_result_t::read offset. Use utf::length::utf32_from_utf16() to find out
+         * the size of the buffer needed. Refer to the overload returning @c std::basic_string for details on @p comply_with_standard.
+         */
+        conversion_result_t utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, char32_t* utf32_buffer, std::size_t utf32_capacity, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-32 string to UTF-8 string stored in a caller-supplied buffer.
+         * 
+         * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+         * @param[out] utf8_buffer pointer to a buffer which will hold converted string.
+         * @param[in] utf8_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Nothing is allocated. If the buffer is too small the function converts as much as fits and returns #status_e::output_too_small,
+         * so the conversion can be continued from conversion_result_t::read offset. Use utf::length::utf8_from_utf32() to find out
+         * the size of the buffer needed. Refer to the overload returning @c std::basic_string for details on @p comply_with_standard.
+         */
+        conversion_result_t utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, char8_t* utf8_buffer, std::size_t utf8_capacity, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-32 string to UTF-16 string stored in a caller-supplied buffer.
+         * 
+         * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+         * @param[out] utf16_buffer pointer to a buffer which will hold converted string.
+         * @param[in] utf16_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Nothing is allocated. If the buffer is too small the function converts as much as fits and returns #status_e::output_too_small,
+         * so the conversion can be continued from conversion_result_t::read offset. Use utf::length::utf16_from_utf32() to find out
+         * the size of the buffer needed. Refer to the overload returning @c std::basic_string for details on @p comply_with_standard.
+         */
+        conversion_result_t utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, char16_t* utf16_buffer, std::size_t utf16_capacity, bool comply_with_standard = false);
+
+        /**
+         * @brief This function converts UTF-8 string to UTF-16 string using multiple threads.
+         * 
+         * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+         * @param[out] utf16_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard.
+         * @param[in] options const reference to the options specified by #parallel_options_t.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * The string is split into chunks of about parallel_options_t::grain_size code units, never inside a code point. The threads
+         * first compute the size of each converted chunk, then convert the chunks into a single preallocated string. The result is
+         * the same as the one of the single-threaded overload, refer to it for details on @p comply_with_standard.
+         */
+        status_e utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard, const parallel_options_t& options);
+        /**
+         * @brief This function converts UTF-8 string to UTF-32 string using multiple threads.
+         * 
+         * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+         * @param[out] utf32_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard.
+         * @param[in] options const reference to the options specified by #parallel_options_t.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * The string is split into chunks of about parallel_options_t::grain_size code units, never inside a code point. The threads
+         * first compute the size of each converted chunk, then convert the chunks into a single preallocated string. The result is
+         * the same as the one of the single-threaded overload, refer to it for details on @p comply_with_standard.
+         */
+        status_e utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard, const parallel_options_t& options);
+        /**
+         * @brief This function converts UTF-16 string to UTF-8 string using multiple threads.
+         * 
+         * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+         * @param[out] utf8_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard.
+         * @param[in] options const reference to the options specified by #parallel_options_t.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * The string is split into chunks of about parallel_options_t::grain_size code units, never inside a code point. The threads
+         * first compute the size of each converted chunk, then convert the chunks into a single preallocated string. The result is
+         * the same as the one of the single-threaded overload, refer to it for details on @p comply_with_standard.
+         */
+        status_e utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard, const parallel_options_t& options);
+        /**
+         * @brief This function converts UTF-16 string to UTF-32 string using multiple threads.
+         * 
+         * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+         * @param[out] utf32_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard.
+         * @param[in] options const reference to the options specified by #parallel_options_t.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * The string is split into chunks of about parallel_options_t::grain_size code units, never inside a code point. The threads
+         * first compute the size of each converted chunk, then convert the chunks into a single preallocated string. The result is
+         * the same as the one of the single-threaded overload, refer to it for details on @p comply_with_standard.
+         */
+        status_e utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard, const parallel_options_t& options);
+        /**
+         * @brief This function converts UTF-32 string to UTF-8 string using multiple threads.
+         * 
+         * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+         * @param[out] utf8_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard.
+         * @param[in] options const reference to the options specified by #parallel_options_t.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * The string is split into chunks of about parallel_options_t::grain_size code units, never inside a code point. The threads
+         * first compute the size of each converted chunk, then convert the chunks into a single preallocated string. The result is
+         * the same as the one of the single-threaded overload, refer to it for details on @p comply_with_standard.
+         */
+        status_e utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard, const parallel_options_t& options);
+        /**
+         * @brief This function converts UTF-32 string to UTF-16 string using multiple threads.
+         * 
+         * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+         * @param[out] utf16_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard.
+         * @param[in] options const reference to the options specified by #parallel_options_t.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * The string is split into chunks of about parallel_options_t::grain_size code units, never inside a code point. The threads
+         * first compute the size of each converted chunk, then convert the chunks into a single preallocated string. The result is
+         * the same as the one of the single-threaded overload, refer to it for details on @p comply_with_standard.
+         */
+        status_e utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard, const parallel_options_t& options);
+
+        /**
+         * @brief This function converts UTF-16 byte stream of the given byte order to UTF-8 string.
+         * 
+         * @param[in] utf16_bytes const reference to a string view representing the bytes of UTF-16 string (e.g. read from a file or a socket).
+         * @param[in] byte_order order of bytes in code units of the input specified by #byte_order_e.
+         * @param[out] utf8_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * Bytes are swapped as the code units are loaded, so there is neither a separate pass over the input nor a temporary copy of it.
+         * The input does not have to be aligned. If its size is not a multiple of the code unit size, #status_e::undefined_error
+         * is returned. Refer to the overload taking native code units for details on @p comply_with_standard.
+         */
+        status_e utf16_to_utf8(const std::string_view& utf16_bytes, byte_order_e byte_order, std::basic_string<char8_t>& utf8_s, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-16 byte stream of the given byte order to UTF-32 string.
+         * 
+         * @param[in] utf16_bytes const reference to a string view representing the bytes of UTF-16 string (e.g. read from a file or a socket).
+         * @param[in] byte_order order of bytes in code units of the input specified by #byte_order_e.
+         * @param[out] utf32_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * Bytes are swapped as the code units are loaded, so there is neither a separate pass over the input nor a temporary copy of it.
+         * The input does not have to be aligned. If its size is not a multiple of the code unit size, #status_e::undefined_error
+         * is returned. Refer to the overload taking native code units for details on @p comply_with_standard.
+         */
+        status_e utf16_to_utf32(const std::string_view& utf16_bytes, byte_order_e byte_order, std::basic_string<char32_t>& utf32_s, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-32 byte stream of the given byte order to UTF-8 string.
+         * 
+         * @param[in] utf32_bytes const reference to a string view representing the bytes of UTF-32 string (e.g. read from a file or a socket).
+         * @param[in] byte_order order of bytes in code units of the input specified by #byte_order_e.
+         * @param[out] utf8_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * Bytes are swapped as the code units are loaded, so there is neither a separate pass over the input nor a temporary copy of it.
+         * The input does not have to be aligned. If its size is not a multiple of the code unit size, #status_e::undefined_error
+         * is returned. Refer to the overload taking native code units for details on @p comply_with_standard.
+         */
+        status_e utf32_to_utf8(const std::string_view& utf32_bytes, byte_order_e byte_order, std::basic_string<char8_t>& utf8_s, bool comply_with_standard = false);
+        /**
+         * @brief This function converts UTF-32 byte stream of the given byte order to UTF-16 string.
+         * 
+         * @param[in] utf32_bytes const reference to a string view representing the bytes of UTF-32 string (e.g. read from a file or a socket).
+         * @param[in] byte_order order of bytes in code units of the input specified by #byte_order_e.
+         * @param[out] utf16_s reference to a string which will hold converted string.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status specified by #status_e enum.
+         * @remarks
+         * Bytes are swapped as the code units are loaded, so there is neither a separate pass over the input nor a temporary copy of it.
+         * The input does not have to be aligned. If its size is not a multiple of the code unit size, #status_e::undefined_error
+         * is returned. Refer to the overload taking native code units for details on @p comply_with_standard.
+         */
+        status_e utf32_to_utf16(const std::string_view& utf32_bytes, byte_order_e byte_order, std::basic_string<char16_t>& utf16_s, bool comply_with_standard = false);
 
         /**
          * @}
          */
 
     } // namespace conversion
-} // namespace utf
 
-//--------------------------------------------------IMPLEMENTATION--------------------------------------------------//
-#if defined IMPLEMENT_UTFUTILS
+    /**
+     * @brief Describes the outcome of string validation.
+     */
+    struct validation_result_t {
+        conversion::status_e status; /**< #conversion::status_e::success if the whole string is valid, the reason of failure otherwise. */
+        std::size_t position; /**< Offset (in code units) of the first invalid sequence. Equals to the string size if the string is valid. */
+    };
+
+    /**
+     * @addtogroup valid_funcs Validation Functions
+     * Functions used to check strings without converting them.
+     * @{
+     */
+
+    /**
+     * @brief This function checks if UTF-8 string is valid.
+     * 
+     * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+     * @param[in] comply_with_standard should the validation comply with Unicode standard. Defaults to @c false.
+     * @return status and position of the first invalid sequence specified by #validation_result_t.
+     * @remarks
+     * The rules are the same as for conversion functions: the string is valid if and only if utf::conversion::utf8_to_utf32()
+     * would succeed with the same @p comply_with_standard value. Encoded surrogates are reported as
+     * conversion::status_e::non_standard_encoding (only if @p comply_with_standard is @c true), any other malformed
+     * sequence as conversion::status_e::undefined_error.
+     */
+    validation_result_t validate_utf8(const std::basic_string_view<char8_t>& utf8_sv, bool comply_with_standard = false);
+    /**
+     * @brief This function checks if UTF-16 string is valid.
+     * 
+     * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+     * @param[in] comply_with_standard should the validation comply with Unicode standard. Defaults to @c false.
+     * @return status and position of the first invalid sequence specified by #validation_result_t.
+     * @remarks
+     * Any UTF-16 string is valid unless @p comply_with_standard is @c true, in which case unpaired surrogates are reported as
+     * conversion::status_e::non_standard_encoding.
+     */
+    validation_result_t validate_utf16(const std::basic_string_view<char16_t>& utf16_sv, bool comply_with_standard = false);
+    /**
+     * @brief This function checks if UTF-32 string is valid.
+     * 
+     * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+     * @param[in] comply_with_standard should the validation comply with Unicode standard. Defaults to @c false.
+     * @return status and position of the first invalid sequence specified by #validation_result_t.
+     * @remarks
+     * Code points greater than @c U+10FFFF are reported as conversion::status_e::undefined_error. Surrogates are reported as
+     * conversion::status_e::non_standard_encoding only if @p comply_with_standard is @c true.
+     */
+    validation_result_t validate_utf32(const std::basic_string_view<char32_t>& utf32_sv, bool comply_with_standard = false);
+
+    /**
+     * @}
+     */
+
+    /**
+     * @namespace utf::length
+     * @brief This namespace contains functions which compute the size of conversion result without converting.
+     */
+    namespace length {
+        /**
+         * @addtogroup length_funcs Length Functions
+         * Functions used to compute the exact number of code units a conversion produces.
+         * @{
+         */
+
+        /**
+         * @brief This function computes the number of UTF-16 code units UTF-8 string converts into.
+         * 
+         * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+         * @return the size of utf::conversion::utf8_to_utf16() result.
+         * @remarks
+         * The string is not validated: every byte which is not a continuation byte is counted as a start of a code point.
+         * The result is exact for any string the conversion succeeds on.
+         */
+        std::size_t utf16_from_utf8(const std::basic_string_view<char8_t>& utf8_sv);
+        /**
+         * @brief This function computes the number of UTF-32 code units (code points) UTF-8 string converts into.
+         * 
+         * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+         * @return the size of utf::conversion::utf8_to_utf32() result.
+         * @remarks
+         * The string is not validated: every byte which is not a continuation byte is counted as a start of a code point.
+         * The result is exact for any string the conversion succeeds on.
+         */
+        std::size_t utf32_from_utf8(const std::basic_string_view<char8_t>& utf8_sv);
+
+        /**
+         * @brief This function computes the number of UTF-8 code units (bytes) UTF-16 string converts into.
+         * 
+         * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+         * @return the size of utf::conversion::utf16_to_utf8() result.
+         * @remarks
+         * Unpaired surrogates are counted the way they are converted when @c comply_with_standard is @c false.
+         */
+        std::size_t utf8_from_utf16(const std::basic_string_view<char16_t>& utf16_sv);
+        /**
+         * @brief This function computes the number of UTF-32 code units (code points) UTF-16 string converts into.
+         * 
+         * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+         * @return the size of utf::conversion::utf16_to_utf32() result.
+         * @remarks
+         * Unpaired surrogates are counted the way they are converted when @c comply_with_standard is @c false.
+         */
+        std::size_t utf32_from_utf16(const std::basic_string_view<char16_t>& utf16_sv);
+
+        /**
+         * @brief This function computes the number of UTF-8 code units (bytes) UTF-32 string converts into.
+         * 
+         * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+         * @return the size of utf::conversion::utf32_to_utf8() result.
+         * @remarks
+         * The string is not validated. The result is exact for any string the conversion succeeds on.
+         */
+        std::size_t utf8_from_utf32(const std::basic_string_view<char32_t>& utf32_sv);
+        /**
+         * @brief This function computes the number of UTF-16 code units UTF-32 string converts into.
+         * 
+         * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+         * @return the size of utf::conversion::utf32_to_utf16() result.
+         * @remarks
+         * The string is not validated. The result is exact for any string the conversion succeeds on.
+         */
+        std::size_t utf16_from_utf32(const std::basic_string_view<char32_t>& utf32_sv);
+
+        /**
+         * @brief This function computes the number of code units a string converts into, picking the length function by types.
+         * 
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t), different from @p to_type.
+         * @param[in] from_sv const reference to a string view representing the string to convert.
+         * @return the size of conversion result.
+         */
+        template <typename to_type, typename from_type>
+        std::size_t converted_length(const std::basic_string_view<from_type>& from_sv) {
+            static_assert(sizeof(from_type) != sizeof(to_type), "the string is already in the requested encoding");
+
+            if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                    return utf16_from_utf8(from_sv);
+                }
+                else {
+                    return utf32_from_utf8(from_sv);
+                }
+            }
+            else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    return utf8_from_utf16(from_sv);
+                }
+                else {
+                    return utf32_from_utf16(from_sv);
+                }
+            }
+            else {
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    return utf8_from_utf32(from_sv);
+                }
+                else {
+                    return utf16_from_utf32(from_sv);
+                }
+            }
+        }
+
+        /**
+         * @}
+         */
+    } // namespace length
+
+    /**
+     * @addtogroup code_point_funcs Code Point Functions
+     * Functions used to count code points and to cut strings without splitting them.
+     * @{
+     */
+
+    /**
+     * @brief This function counts code points of UTF-8 string without converting it.
+     * 
+     * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+     * @return the number of code points.
+     * @remarks
+     * The string is not validated: every byte which is not a continuation byte is counted as a start of a code point.
+     */
+    std::size_t count_code_points(const std::basic_string_view<char8_t>& utf8_sv);
+    /**
+     * @brief This function counts code points of UTF-16 string without converting it.
+     * 
+     * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+     * @return the number of code points.
+     * @remarks
+     * Low surrogate which follows a high one is not counted, any other code unit (including unpaired surrogates) is.
+     */
+    std::size_t count_code_points(const std::basic_string_view<char16_t>& utf16_sv);
+    /**
+     * @brief This function counts code points of UTF-32 string.
+     * 
+     * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+     * @return the number of code points, which is the size of the string.
+     */
+    std::size_t count_code_points(const std::basic_string_view<char32_t>& utf32_sv);
+
+    /**
+     * @brief This function finds where to cut UTF-8 string so that it holds at most the given number of code points.
+     * 
+     * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+     * @param[in] max_code_points maximum number of code points to keep.
+     * @return the size of the longest prefix with at most @p max_code_points code points, in bytes.
+     * @remarks
+     * Code points are counted the same way as count_code_points() does, so the prefix never ends in the middle of a sequence.
+     */
+    std::size_t truncate_to_code_points(const std::basic_string_view<char8_t>& utf8_sv, std::size_t max_code_points);
+    /**
+     * @brief This function finds where to cut UTF-16 string so that it holds at most the given number of code points.
+     * 
+     * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+     * @param[in] max_code_points maximum number of code points to keep.
+     * @return the size of the longest prefix with at most @p max_code_points code points, in code units.
+     * @remarks
+     * Code points are counted the same way as count_code_points() does, so the prefix never ends in the middle of a surrogate pair.
+     */
+    std::size_t truncate_to_code_points(const std::basic_string_view<char16_t>& utf16_sv, std::size_t max_code_points);
+    /**
+     * @brief This function finds where to cut UTF-32 string so that it holds at most the given number of code points.
+     * 
+     * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+     * @param[in] max_code_points maximum number of code points to keep.
+     * @return the size of the longest prefix with at most @p max_code_points code points, in code units.
+     */
+    std::size_t truncate_to_code_points(const std::basic_string_view<char32_t>& utf32_sv, std::size_t max_code_points);
+
+    /**
+     * @brief This function finds where to cut UTF-8 string so that it takes at most the given number of bytes.
+     * 
+     * @param[in] utf8_sv const reference to a string view representing UTF-8 string.
+     * @param[in] max_bytes maximum number of bytes to keep.
+     * @return the size of the longest prefix which fits into @p max_bytes and does not end in the middle of a sequence, in bytes.
+     * @remarks
+     * Only up to 3 bytes before the cut are looked at, so the time does not depend on the size of the string.
+     */
+    std::size_t truncate_to_bytes(const std::basic_string_view<char8_t>& utf8_sv, std::size_t max_bytes);
+    /**
+     * @brief This function finds where to cut UTF-16 string so that it takes at most the given number of bytes.
+     * 
+     * @param[in] utf16_sv const reference to a string view representing UTF-16 string.
+     * @param[in] max_bytes maximum number of bytes to keep.
+     * @return the size of the longest prefix which fits into @p max_bytes and does not end in the middle of a surrogate pair, in code units.
+     */
+    std::size_t truncate_to_bytes(const std::basic_string_view<char16_t>& utf16_sv, std::size_t max_bytes);
+    /**
+     * @brief This function finds where to cut UTF-32 string so that it takes at most the given number of bytes.
+     * 
+     * @param[in] utf32_sv const reference to a string view representing UTF-32 string.
+     * @param[in] max_bytes maximum number of bytes to keep.
+     * @return the size of the longest prefix which fits into @p max_bytes, in code units.
+     */
+    std::size_t truncate_to_bytes(const std::basic_string_view<char32_t>& utf32_sv, std::size_t max_bytes);
+
+    /**
+     * @}
+     */
+
+    /**
+     * @addtogroup dispatch CPU Dispatch
+     * Functions used to query and override the instruction set the library uses.
+     * @{
+     */
+
+    /**
+     * @brief Instruction set tiers the kernels are built for, each one includes the previous ones.
+     */
+    enum class simd_tier_e : int8_t {
+        scalar, /**< Plain C++. */
+        sse2,   /**< SSE2. */
+        sse42,  /**< SSE2 up to SSE4.2 (including SSSE3). */
+        avx2,   /**< AVX2. */
+        avx512  /**< AVX-512F and AVX-512BW. */
+    };
+
+    /**
+     * @brief This function returns the best tier the CPU (and the OS) supports.
+     *
+     * @return tier specified by #simd_tier_e enum.
+     * @remarks
+     * Always simd_tier_e::scalar on anything but x86.
+     */
+    simd_tier_e supported_simd_tier();
+    /**
+     * @brief This function returns the tier all functions of the library currently use.
+     *
+     * @return tier specified by #simd_tier_e enum.
+     * @remarks
+     * The tier is the supported one unless it has been lowered by set_simd_tier() or by @c UTFUTILS_SIMD_TIER environment
+     * variable (one of @c scalar, @c sse2, @c sse42, @c avx2 or @c avx512), which is read once on the first call to the library.
+     */
+    simd_tier_e active_simd_tier();
+    /**
+     * @brief This function makes all functions of the library use the given tier.
+     *
+     * @param[in] tier tier specified by #simd_tier_e enum.
+     * @return the tier actually set: @p tier, or the supported one if @p tier is not supported.
+     * @remarks
+     * Meant for benchmarking and testing every tier on one machine. Takes effect immediately, but calls already running in
+     * other threads may finish with the previous tier.
+     */
+    simd_tier_e set_simd_tier(simd_tier_e tier);
+
+    /**
+     * @}
+     */
 
-namespace utf {
     /**
      * @internal
      * @brief This namespace contains various constants.
@@ -197,6 +791,13 @@ namespace utf {
          * See <a href="https://en.wikipedia.org/wiki/UTF-16#Code_points_from_U+010000_to_U+10FFFF">Wikipedia article</a> about this value.
          */
         constexpr uint8_t  low_surrogate_marker       = 0xDC00 >> 10;
+        /**
+         * @internal
+         * @brief The last code point of the "low" surrogates range and therefore of the whole surrogates range.
+         * @details
+         * See <a href="https://en.wikipedia.org/wiki/UTF-16#U+D800_to_U+DFFF">Wikipedia article</a> about this value.
+         */
+        constexpr uint16_t surrogate_end              = 0xDFFF;
         /**
          * @internal
          * @brief Unicode "Supllementary Planes" (1 through 16) offset.
@@ -260,6 +861,12 @@ namespace utf {
          * See <a href="https://en.wikipedia.org/wiki/UTF-8#Encoding">Wikipedia UTF-8#Encoding</a>.
          */
         constexpr uint8_t quadruple_byte_marker       = 0b11110;
+        /**
+         * @brief Code point substituted for code units which can not be decoded
+         * @details
+         * See <a href="https://en.wikipedia.org/wiki/Specials_(Unicode_block)#Replacement_character">Wikipedia Replacement character</a>.
+         */
+        constexpr uint16_t replacement_character      = 0xFFFD;
 
         /**
          * @}
@@ -297,161 +904,1188 @@ namespace utf {
         return constants::low_surrogate_marker == ch >> 10;
     }
     /**
-     * @}
+     * @internal
+     * @brief Encodes a single code point as UTF-8 sequence.
+     * @param code_point Code point to encode. Must not be greater than constants::four_byte_boundary.
+     * @param out Pointer to the buffer with at least 4 bytes of free space.
+     * @return pointer past the last written byte.
+     * @details
+     * See <a href="https://en.wikipedia.org/wiki/UTF-8#Encoding">Wikipedia UTF-8#Encoding</a>.
      */
-}
-
-using namespace utf;
-using namespace utf::conversion;
-using namespace utf::constants;
+    constexpr char8_t* encode_utf8(const char32_t code_point, char8_t* out) {
+        using namespace constants;
 
-status_e utf::conversion::utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard = false) {
-    std::basic_string<char32_t> code_points;
-    return status_e::success;
-}
+        if (code_point <= one_byte_boundary) {
+            *out++ = static_cast<char8_t>(code_point);
+            return out;
+        }
+        if (code_point <= two_byte_boundary) {
+            *out++ = static_cast<char8_t>((double_byte_marker   << 5) +  (code_point >>  6));
+            *out++ = static_cast<char8_t>((trailing_byte_marker << 6) +  (code_point & 0x3F));
+            return out;
+        }
+        if (code_point <= three_byte_boundary) {
+            *out++ = static_cast<char8_t>((triple_byte_marker   << 4) +  (code_point >> 12));
+            *out++ = static_cast<char8_t>((trailing_byte_marker << 6) + ((code_point >>  6) & 0x3F));
+            *out++ = static_cast<char8_t>((trailing_byte_marker << 6) +  (code_point & 0x3F));
+            return out;
+        }
+        *out++ = static_cast<char8_t>((quadruple_byte_marker << 3) +  (code_point >> 18));
+        *out++ = static_cast<char8_t>((trailing_byte_marker  << 6) + ((code_point >> 12) & 0x3F));
+        *out++ = static_cast<char8_t>((trailing_byte_marker  << 6) + ((code_point >>  6) & 0x3F));
+        *out++ = static_cast<char8_t>((trailing_byte_marker  << 6) +  (code_point & 0x3F));
+        return out;
+    }
+    /**
+     * @internal
+     * @brief Checks if code point lies in the surrogates range (@c U+D800 to @c U+DFFF)
+     * @param code_point Code point to check
+     * @return true if code point is a surrogate
+     * @return false if code point is not a surrogate
+     */
+    constexpr bool is_surrogate(const char32_t code_point) {
+        return code_point >= constants::high_surrogate_start && code_point <= constants::surrogate_end;
+    }
+    /**
+     * @internal
+     * @brief Computes the number of UTF-8 code units (bytes) the code point is encoded with.
+     * @param code_point Code point to encode. Must not be greater than constants::four_byte_boundary.
+     */
+    constexpr std::size_t utf8_sequence_length(const char32_t code_point) {
+        return 1 + (code_point > constants::one_byte_boundary)   +
+                   (code_point > constants::two_byte_boundary)   +
+                   (code_point > constants::three_byte_boundary);
+    }
+    /**
+     * @internal
+     * @brief Computes the number of UTF-16 code units the code point is encoded with.
+     * @param code_point Code point to encode. Must not be greater than constants::four_byte_boundary.
+     */
+    constexpr std::size_t utf16_sequence_length(const char32_t code_point) {
+        return 1 + (code_point > constants::three_byte_boundary);
+    }
+    /**
+     * @internal
+     * @brief Encodes a single code point as UTF-16 sequence.
+     * @param code_point Code point to encode. Must not be greater than constants::four_byte_boundary.
+     * @param out Pointer to the buffer with at least 2 code units of free space.
+     * @return pointer past the last written code unit.
+     * @details
+     * See <a href="https://en.wikipedia.org/wiki/UTF-16#Code_points_from_U+010000_to_U+10FFFF">About surrogates</a>.
+     */
+    constexpr char16_t* encode_utf16(const char32_t code_point, char16_t* out) {
+        using namespace constants;
 
-status_e utf::conversion::utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard = false) {
-    // Convert to UTF-32
-    std::basic_string<char32_t> code_points;
-    status_e status = utf16_to_utf32(utf16_sv, code_points, comply_with_standard);
-    if (status < status_e::success) {
-        return status;
+        if (code_point < supplementary_plane_offset) {
+            *out++ = static_cast<char16_t>(code_point);
+            return out;
+        }
+        const char32_t offset_code_point = code_point - supplementary_plane_offset;
+        *out++ = static_cast<char16_t>(high_surrogate_start + (offset_code_point >> 10));
+        *out++ = static_cast<char16_t>(low_surrogate_start  + (offset_code_point & 0x3FF));
+        return out;
     }
-    // Convert to UTF-8
-    std::basic_string<char8_t> result_string;
-    status = utf32_to_utf8(code_points, result_string, comply_with_standard);
-    if (status < status_e::success) {
-        return status;
+    /**
+     * @internal
+     * @brief Decodes a single UTF-8 sequence.
+     * @param[in,out] it Pointer to the first byte of the sequence. Moved past the sequence on success, left untouched otherwise.
+     * @param[in] end Pointer past the last byte of the string.
+     * @param[out] code_point Decoded code point.
+     * @return conversion::status_e::success if the sequence is well-formed, conversion::status_e::undefined_error otherwise.
+     * @remarks
+     * Surrogates (@c U+D800 to @c U+DFFF) are decoded as any other code point, it is up to the caller to reject them.
+     * Overlong sequences and code points greater than constants::four_byte_boundary are rejected.
+     * @details
+     * See <a href="https://en.wikipedia.org/wiki/UTF-8#Encoding">Wikipedia UTF-8#Encoding</a>.
+     */
+    constexpr conversion::status_e decode_utf8(const char8_t*& it, const char8_t* end, char32_t& code_point) {
+        using namespace constants;
+
+        const char8_t lead_byte = *it;
+        std::size_t   length    = 0;
+        char32_t      result    = 0;
+        char32_t      min_value = 0;
+
+        if (lead_byte <= one_byte_boundary) {
+            code_point = lead_byte;
+            it++;
+            return conversion::status_e::success;
+        }
+        if (lead_byte >> 5 == double_byte_marker) {
+            length    = 2;
+            result    = lead_byte & 0x1F;
+            min_value = one_byte_boundary + 1;
+        }
+        else if (lead_byte >> 4 == triple_byte_marker) {
+            length    = 3;
+            result    = lead_byte & 0x0F;
+            min_value = two_byte_boundary + 1;
+        }
+        else if (lead_byte >> 3 == quadruple_byte_marker) {
+            length    = 4;
+            result    = lead_byte & 0x07;
+            min_value = three_byte_boundary + 1;
+        }
+        else {
+            return conversion::status_e::undefined_error;
+        }
+
+        if (static_cast<std::size_t>(end - it) < length) {
+            return conversion::status_e::undefined_error;
+        }
+        for (std::size_t i = 1; i < length; i++) {
+            if (it[i] >> 6 != trailing_byte_marker) {
+                return conversion::status_e::undefined_error;
+            }
+            result = (result << 6) + (it[i] & 0x3F);
+        }
+        // reject overlong sequences and code points outside of Unicode range
+        if (result < min_value || result > four_byte_boundary) {
+            return conversion::status_e::undefined_error;
+        }
+
+        code_point = result;
+        it += length;
+        return conversion::status_e::success;
     }
+    /**
+     * @}
+     */
 
-    utf8_s = result_string;
-    return status_e::success;
-}
+    namespace conversion {
+        /**
+         * @addtogroup conv_funcs
+         * @{
+         */
 
-status_e utf::conversion::utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard = false) {
-    // vector of UTF-32 characters (code points)
-    std::basic_string<char32_t> code_points;
+        /**
+         * @brief This function converts a string into a caller-supplied buffer, picking the conversion function by types.
+         * 
+         * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t), different from @p from_type.
+         * @param[in] from_sv const reference to a string view representing the string to convert.
+         * @param[out] to_buffer pointer to a buffer which will hold converted string.
+         * @param[in] to_capacity size of the buffer in code units.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @return status and numbers of code units read and written specified by #conversion_result_t.
+         * @remarks
+         * Useful in generic code. Refer to the respective conversion function for details.
+         */
+        template <typename from_type, typename to_type>
+        conversion_result_t convert(const std::basic_string_view<from_type>& from_sv, to_type* to_buffer, std::size_t to_capacity, bool comply_with_standard = false) {
+            static_assert(sizeof(from_type) != sizeof(to_type), "the string is already in the requested encoding");
 
-    bool was_double_character = false;
-    for (auto character_it = utf16_sv.begin(); character_it < utf16_sv.end(); character_it++) {
-        // skip this character, because we handled it last iteration
-        if (was_double_character) {
-            was_double_character = false;
-            continue;
+            if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                    return utf8_to_utf16(from_sv, to_buffer, to_capacity, comply_with_standard);
+                }
+                else {
+                    return utf8_to_utf32(from_sv, to_buffer, to_capacity, comply_with_standard);
+                }
+            }
+            else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    return utf16_to_utf8(from_sv, to_buffer, to_capacity, comply_with_standard);
+                }
+                else {
+                    return utf16_to_utf32(from_sv, to_buffer, to_capacity, comply_with_standard);
+                }
+            }
+            else {
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    return utf32_to_utf8(from_sv, to_buffer, to_capacity, comply_with_standard);
+                }
+                else {
+                    return utf32_to_utf16(from_sv, to_buffer, to_capacity, comply_with_standard);
+                }
+            }
         }
-        // get this character
-        char16_t this_character = *character_it;
 
-        // check if this character is the last one
-        const bool exists_next_character = (character_it + 1) != utf16_sv.end();
-        char16_t next_character;
+        /**
+         * @brief This function converts a string into a caller-supplied buffer, handling ill-formed input as the policy says.
+         * 
+         * @tparam policy what to do with ill-formed input specified by #error_policy_e.
+         * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t), different from @p from_type.
+         * @param[in] from_sv const reference to a string view representing the string to convert.
+         * @param[out] to_buffer pointer to a buffer which will hold converted string.
+         * @param[in] to_capacity size of the buffer in code units.
+         * @return status, numbers of code units read and written and number of replacements specified by #conversion_result_t.
+         * @remarks
+         * The policy is a template parameter, so the conversion loop is compiled for each policy and checks nothing at run time
+         * but the input. With #error_policy_e::replace and #error_policy_e::skip the conversion fails only if the buffer is too
+         * small, and the length functions may underestimate the space the replacement characters take.
+         */
+        template <error_policy_e policy, typename from_type, typename to_type>
+        conversion_result_t convert(const std::basic_string_view<from_type>& from_sv, to_type* to_buffer, std::size_t to_capacity);
 
-        // get next character if there is one
-        if (exists_next_character) {
-            next_character = *(character_it + 1);
+        /**
+         * @brief This function converts a string, handling ill-formed input as the policy says.
+         * 
+         * @tparam policy what to do with ill-formed input specified by #error_policy_e.
+         * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t), different from @p from_type.
+         * @param[in] from_sv const reference to a string view representing the string to convert.
+         * @param[out] to_s reference to a string which will hold converted string. Left untouched if the conversion fails.
+         * @return status and number of replacements specified by #conversion_result_t.
+         * @remarks
+         * Dirty input is converted in a single pass, there is no need to validate or clean it first. The output is sized for
+         * well-formed input and grows only if the replacement characters do not fit.
+         */
+        template <error_policy_e policy, typename from_type, typename to_type>
+        conversion_result_t convert(const std::basic_string_view<from_type>& from_sv, std::basic_string<to_type>& to_s) {
+            std::basic_string<to_type> result(length::converted_length<to_type>(from_sv), 0);
+            conversion_result_t total{ status_e::success, 0, 0, 0 };
+
+            while (true) {
+                const conversion_result_t conversion_result = convert<policy>(from_sv.substr(total.read), result.data() + total.written, result.size() - total.written);
+                total.status        = conversion_result.status;
+                total.read         += conversion_result.read;
+                total.written      += conversion_result.written;
+                total.replacements += conversion_result.replacements;
+                if (total.status != status_e::output_too_small) {
+                    break;
+                }
+                // the conversion stopped at a code point boundary, so it resumes from there
+                result.resize(result.size() * 2 + 4);
+            }
+            if (total.status < status_e::success) {
+                return total;
+            }
+
+            result.resize(total.written);
+            to_s = std::move(result);
+            return total;
         }
 
-        // if can be part of double character
-        if (is_high_surrogate(this_character)) {
-            // if there is no next character we add this as code point
-            if (!exists_next_character) {
-                if (!comply_with_standard) {
-                    code_points.push_back(this_character);
+        /**
+         * @brief Describes the result of converting a single string of a batch.
+         */
+        struct batch_item_t {
+            status_e status;    /**< Status of the conversion specified by #status_e enum. */
+            std::size_t offset; /**< Position of the converted string in the arena. */
+            std::size_t length; /**< Length of the converted string in code units, @c 0 if the conversion has failed. */
+        };
+
+        /**
+         * @brief Holds the results of a batch conversion.
+         *
+         * @tparam to_type type of output code units.
+         * @remarks
+         * Reusing the same object for subsequent batches reuses its memory, so a batch no larger than the previous ones
+         * does not allocate at all.
+         */
+        template <typename to_type>
+        struct batch_result_t {
+            std::basic_string<to_type> arena; /**< All converted strings, one after another. */
+            std::vector<batch_item_t> items;  /**< One entry per input string, in the order of the input. */
+
+            /**
+             * @brief Returns a view of the converted string at the given index.
+             */
+            std::basic_string_view<to_type> operator[](std::size_t index) const {
+                return std::basic_string_view<to_type>(arena).substr(items[index].offset, items[index].length);
+            }
+        };
+
+        /**
+         * @internal
+         * @brief Converts a batch of strings, @p input returns a string view of the string at the given index.
+         */
+        template <typename to_type, typename input_type>
+        void convert_each(std::size_t count, const input_type& input, batch_result_t<to_type>& result, bool comply_with_standard) {
+            result.items.resize(count);
+
+            // the lengths of valid strings are exact, so the arena can only shrink afterwards
+            std::size_t arena_size = 0;
+            for (std::size_t i = 0; i < count; i++) {
+                result.items[i].length = length::converted_length<to_type>(input(i));
+                arena_size += result.items[i].length;
+            }
+            result.arena.resize(arena_size);
+
+            std::size_t offset = 0;
+            for (std::size_t i = 0; i < count; i++) {
+                batch_item_t& item = result.items[i];
+                const conversion_result_t conversion_result = convert(input(i), result.arena.data() + offset, item.length, comply_with_standard);
+                item.offset = offset;
+                if (conversion_result.status < status_e::success) {
+                    item.status = conversion_result.status;
+                    item.length = 0;
                     continue;
                 }
-                return status_e::non_standard_encoding;
+
+                item.status = status_e::success;
+                offset += item.length;
             }
+            result.arena.resize(offset);
+        }
 
-            // if next character is not part of the double character we add this as code point
-            if (!is_low_surrogate(next_character)) {
-                if (!comply_with_standard) {
-                    code_points.push_back(this_character);
-                    continue;
+        /**
+         * @brief This function converts many strings at once into a single arena.
+         *
+         * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t), different from @p from_type.
+         * @param[in] from_svs pointer to an array of string views representing the strings to convert.
+         * @param[in] count number of strings.
+         * @param[out] result reference to an object which will hold converted strings specified by #batch_result_t.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @remarks
+         * The arena is sized once for the whole batch, so there are at most two allocations (the arena and the items) per call.
+         * A string which fails to convert gets its status in the respective item and takes no space in the arena, the rest of
+         * the batch is converted as usual.
+         */
+        template <typename from_type, typename to_type>
+        void convert_batch(const std::basic_string_view<from_type>* from_svs, std::size_t count, batch_result_t<to_type>& result, bool comply_with_standard = false) {
+            convert_each(count, [from_svs](std::size_t i) { return from_svs[i]; }, result, comply_with_standard);
+        }
+
+        /**
+         * @brief This function converts many strings stored one after another in a single buffer.
+         *
+         * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t), different from @p from_type.
+         * @param[in] from_sv const reference to a string view representing the concatenated strings.
+         * @param[in] offsets pointer to an array of @p count + 1 ascending positions, string @c i spans from @c offsets[i] to @c offsets[i + 1].
+         * @param[in] count number of strings.
+         * @param[out] result reference to an object which will hold converted strings specified by #batch_result_t.
+         * @param[in] comply_with_standard should the conversion function comply with Unicode standard. Defaults to @c false.
+         * @remarks
+         * Refer to the overload taking an array of string views for details.
+         */
+        template <typename from_type, typename to_type>
+        void convert_batch(const std::basic_string_view<from_type>& from_sv, const std::size_t* offsets, std::size_t count, batch_result_t<to_type>& result, bool comply_with_standard = false) {
+            convert_each(count, [&from_sv, offsets](std::size_t i) { return from_sv.substr(offsets[i], offsets[i + 1] - offsets[i]); }, result, comply_with_standard);
+        }
+
+        /**
+         * @}
+         */
+    } // namespace conversion
+
+    /**
+     * @brief Converts a string which arrives in chunks of arbitrary size (e.g. read from a socket or a file).
+     * 
+     * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+     * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t), different from @p from_type.
+     * @details
+     * Sequences cut by a chunk boundary (the beginning of UTF-8 sequence or a high surrogate at the end of a chunk) are carried
+     * over to the next call of convert(), so the result does not depend on the way the string is split. Only a few code units
+     * are kept between calls, so the memory used does not depend on the size of the string.
+     * 
+     * Once conversion fails the converter keeps returning the same status until reset() is called.
+     */
+    template <typename from_type, typename to_type>
+    class stream_converter {
+        static_assert(sizeof(from_type) != sizeof(to_type), "the string is already in the requested encoding");
+
+    public:
+        /**
+         * @brief Creates a converter.
+         * @param[in] comply_with_standard should the conversion comply with Unicode standard. Defaults to @c false.
+         * Refer to the respective conversion function for details.
+         */
+        explicit stream_converter(bool comply_with_standard = false)
+            : m_comply_with_standard(comply_with_standard) {
+        }
+
+        /**
+         * @brief Converts the next chunk of the string.
+         * 
+         * @param[in] chunk const reference to a string view representing the next chunk.
+         * @param[out] output reference to a string converted code units are appended to.
+         * @return status specified by conversion::status_e enum.
+         * @remarks
+         * On failure everything converted before the malformed sequence is still appended to @p output.
+         */
+        conversion::status_e convert(const std::basic_string_view<from_type>& chunk, std::basic_string<to_type>& output) {
+            if (m_status < conversion::status_e::success) {
+                return m_status;
+            }
+
+            std::basic_string_view<from_type> rest = chunk;
+
+            // complete the sequence carried over from the previous chunk first
+            if (m_pending_size > 0) {
+                const std::size_t taken = complete_pending(rest);
+                rest.remove_prefix(taken);
+                if (m_pending_size < m_pending_needed) {
+                    // the chunk was too short to complete it
+                    return m_status;
+                }
+                append(std::basic_string_view<from_type>(m_pending, m_pending_size), output);
+                m_pending_size = 0;
+                if (m_status < conversion::status_e::success) {
+                    return m_status;
                 }
-                return status_e::non_standard_encoding;
             }
 
-            // it turned out we have a double character
-            was_double_character = true;
+            // keep the incomplete sequence at the end until the next chunk arrives
+            const std::size_t tail = incomplete_tail(rest);
+            append(rest.substr(0, rest.size() - tail), output);
+            if (m_status < conversion::status_e::success) {
+                return m_status;
+            }
+            for (std::size_t i = 0; i < tail; i++) {
+                m_pending[i] = rest[rest.size() - tail + i];
+            }
+            m_pending_size   = tail;
+            m_pending_needed = tail > 0 ? sequence_size(m_pending[0]) : 0;
+            return m_status;
+        }
 
-            // do decoding "double UTF-16" -> UTF-32:
-            // https://en.wikipedia.org/wiki/UTF-16#Code_points_from_U+010000_to_U+10FFFF
-            char32_t high_code_point = (this_character - high_surrogate_start) << 10;
-            char16_t low_code_point = next_character - low_surrogate_start;
-            char32_t code_point = high_code_point + low_code_point + supplementary_plane_offset;
-            code_points.push_back(code_point);
+        /**
+         * @brief Tells the converter there are no more chunks.
+         * 
+         * @param[out] output reference to a string converted code units are appended to.
+         * @return status specified by conversion::status_e enum.
+         * @remarks
+         * Converts the sequence carried over from the last chunk as if the string ended there (incomplete UTF-8 sequence is
+         * malformed, lone high surrogate is converted as is unless the conversion is strict), then resets the converter.
+         */
+        conversion::status_e finish(std::basic_string<to_type>& output) {
+            if (m_status == conversion::status_e::success && m_pending_size > 0) {
+                append(std::basic_string_view<from_type>(m_pending, m_pending_size), output);
+            }
+            const conversion::status_e status = m_status;
+            reset();
+            return status;
+        }
 
-            continue;
+        /**
+         * @brief Drops the carried over sequence and the failure status, so a new string can be converted.
+         */
+        void reset() {
+            m_pending_size   = 0;
+            m_pending_needed = 0;
+            m_status         = conversion::status_e::success;
         }
 
-        // if not a double character add this as next code point
-        code_points.push_back(this_character);
-    }
-    // return resulting string
-    utf32_s =  code_points;
-    return status_e::success;
-}
+    private:
+        /**
+         * @brief Returns the number of code units the sequence starting with the given code unit should have.
+         */
+        static std::size_t sequence_size(const from_type first) {
+            if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                const char8_t lead_byte = static_cast<char8_t>(first);
+                return lead_byte >> 5 == constants::double_byte_marker    ? 2 :
+                       lead_byte >> 4 == constants::triple_byte_marker    ? 3 :
+                       lead_byte >> 3 == constants::quadruple_byte_marker ? 4 : 1;
+            }
+            else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                return is_high_surrogate(first) ? 2 : 1;
+            }
+            else {
+                return 1;
+            }
+        }
 
-status_e utf::conversion::utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard = false) {
-    std::basic_string<char8_t> result;
+        /**
+         * @brief Returns the number of code units at the end of the string that may be completed by the next chunk.
+         */
+        static std::size_t incomplete_tail(const std::basic_string_view<from_type>& sv) {
+            // look for the beginning of the last sequence among the last 3 bytes (or the last UTF-16 code unit)
+            const std::size_t max_back = std::min<std::size_t>(sv.size(), sizeof(from_type) == sizeof(char8_t) ? 3 : 1);
+            for (std::size_t back = 1; back <= max_back; back++) {
+                const from_type unit = sv[sv.size() - back];
+                if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                    if (static_cast<char8_t>(unit) >> 6 == constants::trailing_byte_marker) {
+                        continue;
+                    }
+                }
+                return sequence_size(unit) > back ? back : 0;
+            }
+            return 0;
+        }
 
-    for (const char32_t this_code_point : utf32_sv) {
-        if (this_code_point > four_byte_boundary) {
-            return status_e::undefined_error;
+        /**
+         * @brief Moves code units from the chunk to the carried over sequence until it is complete or turns out to be malformed.
+         * @return the number of code units taken from the chunk.
+         */
+        std::size_t complete_pending(const std::basic_string_view<from_type>& chunk) {
+            std::size_t taken = 0;
+            while (m_pending_size < std::min<std::size_t>(m_pending_needed, std::size(m_pending)) && taken < chunk.size()) {
+                const from_type unit = chunk[taken];
+                bool continues_sequence = false;
+                if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                    continues_sequence = static_cast<char8_t>(unit) >> 6 == constants::trailing_byte_marker;
+                }
+                else {
+                    continues_sequence = is_low_surrogate(unit);
+                }
+                if (!continues_sequence) {
+                    // let the conversion decide what to do with the cut sequence
+                    m_pending_needed = m_pending_size;
+                    break;
+                }
+                m_pending[m_pending_size++] = unit;
+                taken++;
+            }
+            return taken;
         }
-        if (this_code_point <= one_byte_boundary) {
-            result.push_back(this_code_point);
-            continue;
+
+        /**
+         * @brief Converts the string and appends the result to the output, remembers the status.
+         */
+        void append(const std::basic_string_view<from_type>& sv, std::basic_string<to_type>& output) {
+            const std::size_t old_size = output.size();
+            output.resize(old_size + length::converted_length<to_type>(sv));
+            const conversion::conversion_result_t result = conversion::convert(sv, output.data() + old_size, output.size() - old_size, m_comply_with_standard);
+            output.resize(old_size + result.written);
+            m_status = result.status;
         }
-        if (this_code_point <= two_byte_boundary) {
-            uint16_t cp_16        = static_cast<uint16_t>(this_code_point);
 
-            uint8_t  first_5_bits =  cp_16 >>  6;
-            uint8_t  last_6_bits  = (cp_16 << 10) >> 10;
+        from_type            m_pending[4]     = {}; /**< Code units of the sequence cut by the chunk boundary. */
+        std::size_t          m_pending_size   = 0; /**< Number of code units in #m_pending. */
+        std::size_t          m_pending_needed = 0; /**< Number of code units the sequence in #m_pending should have. */
+        bool                 m_comply_with_standard;  /**< Should the conversion comply with Unicode standard. */
+        conversion::status_e m_status         = conversion::status_e::success; /**< Status of the last conversion. */
+    };
 
-            result.push_back((double_byte_marker << 5) + first_5_bits);
-            result.push_back((trailing_byte_marker << 6) + last_6_bits);
+#if !defined(UTFUTILS_HEADER_ONLY)
+    // every pair of encodings is instantiated once in the library
+    extern template class stream_converter<char8_t, char16_t>;
+    extern template class stream_converter<char8_t, char32_t>;
+    extern template class stream_converter<char16_t, char8_t>;
+    extern template class stream_converter<char16_t, char32_t>;
+    extern template class stream_converter<char32_t, char8_t>;
+    extern template class stream_converter<char32_t, char16_t>;
+
+    // so is every error policy
+#   define UTFUTILS_EXTERN_CONVERT(policy)                                                                                                      \
+        extern template conversion::conversion_result_t conversion::convert<policy>(const std::basic_string_view<char8_t>&, char16_t*, std::size_t);  \
+        extern template conversion::conversion_result_t conversion::convert<policy>(const std::basic_string_view<char8_t>&, char32_t*, std::size_t);  \
+        extern template conversion::conversion_result_t conversion::convert<policy>(const std::basic_string_view<char16_t>&, char8_t*, std::size_t);  \
+        extern template conversion::conversion_result_t conversion::convert<policy>(const std::basic_string_view<char16_t>&, char32_t*, std::size_t); \
+        extern template conversion::conversion_result_t conversion::convert<policy>(const std::basic_string_view<char32_t>&, char8_t*, std::size_t);  \
+        extern template conversion::conversion_result_t conversion::convert<policy>(const std::basic_string_view<char32_t>&, char16_t*, std::size_t);
+    UTFUTILS_EXTERN_CONVERT(conversion::error_policy_e::strict)
+    UTFUTILS_EXTERN_CONVERT(conversion::error_policy_e::replace)
+    UTFUTILS_EXTERN_CONVERT(conversion::error_policy_e::skip)
+    UTFUTILS_EXTERN_CONVERT(conversion::error_policy_e::pass_through)
+#   undef UTFUTILS_EXTERN_CONVERT
+#endif
 
-            continue;
+    /**
+     * @addtogroup views Views
+     * Lazy, allocation-free access to code points and code units of another encoding.
+     * @{
+     */
+
+    /**
+     * @brief Bidirectional iterator over code points of UTF-8, UTF-16 or UTF-32 string, decodes them on the fly.
+     *
+     * @tparam char_type type of code units (@c char8_t, @c char16_t or @c char32_t).
+     * @details
+     * Decoding is lenient, as conversion functions are by default: unpaired surrogates are yielded as is. Each code unit
+     * which can not be decoded (malformed UTF-8 sequence, UTF-32 code unit out of Unicode range) is yielded as
+     * constants::replacement_character, so iterating never fails and both directions see the same code points.
+     */
+    template <typename char_type>
+    class code_point_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type        = char32_t;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = char32_t;
+
+        code_point_iterator() = default;
+
+        /**
+         * @brief Creates an iterator pointing to the code point starting at @p position.
+         * @param[in] begin pointer to the first code unit of the string.
+         * @param[in] end pointer past the last code unit of the string.
+         * @param[in] position pointer to the first code unit of a code point, or @p end.
+         */
+        code_point_iterator(const char_type* begin, const char_type* end, const char_type* position)
+            : m_begin(begin), m_end(end), m_position(position) {
+            decode();
         }
-        if (this_code_point <= three_byte_boundary) {
-            uint16_t cp_16      = static_cast<uint16_t>(this_code_point);
 
-            bool wrong_encoding = comply_with_standard           &&
-                                  cp_16 < low_surrogate_start    &&
-                                  cp_16 > high_surrogate_start;
-            if (wrong_encoding) {
-                    return status_e::non_standard_encoding;
+        /**
+         * @brief Returns the current code point.
+         */
+        char32_t operator*() const {
+            return m_code_point;
+        }
+
+        code_point_iterator& operator++() {
+            m_position += m_length;
+            decode();
+            return *this;
+        }
+        code_point_iterator operator++(int) {
+            code_point_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        code_point_iterator& operator--() {
+            m_position -= previous_length();
+            decode();
+            return *this;
+        }
+        code_point_iterator operator--(int) {
+            code_point_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const code_point_iterator& other) const {
+            return m_position == other.m_position;
+        }
+        bool operator!=(const code_point_iterator& other) const {
+            return m_position != other.m_position;
+        }
+
+        /**
+         * @brief Returns the pointer to the first code unit of the current code point.
+         * @remarks
+         * Everything before it is a whole number of code points, so it can be used to cut the string at a code point boundary.
+         */
+        const char_type* base() const {
+            return m_position;
+        }
+
+        /**
+         * @brief Returns the number of code units the current code point is encoded with.
+         */
+        std::size_t length() const {
+            return m_length;
+        }
+
+    private:
+        /**
+         * @brief Decodes the code point at the current position.
+         */
+        void decode() {
+            m_code_point = constants::replacement_character;
+            m_length     = 1;
+            if (m_position == m_end) {
+                m_length = 0;
+                return;
+            }
+
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                const char8_t* it = reinterpret_cast<const char8_t*>(m_position);
+                if (decode_utf8(it, reinterpret_cast<const char8_t*>(m_end), m_code_point) == conversion::status_e::success) {
+                    m_length = static_cast<std::size_t>(it - reinterpret_cast<const char8_t*>(m_position));
+                }
+                else {
+                    m_code_point = constants::replacement_character;
+                }
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                m_code_point = static_cast<char16_t>(m_position[0]);
+                if (is_high_surrogate(m_position[0]) && m_end - m_position > 1 && is_low_surrogate(m_position[1])) {
+                    m_code_point = ((m_position[0] - constants::high_surrogate_start) << 10) +
+                                   (m_position[1] - constants::low_surrogate_start)          +
+                                   constants::supplementary_plane_offset;
+                    m_length     = 2;
+                }
+            }
+            else {
+                if (static_cast<char32_t>(m_position[0]) <= constants::four_byte_boundary) {
+                    m_code_point = static_cast<char32_t>(m_position[0]);
+                }
+            }
+        }
+
+        /**
+         * @brief Returns the number of code units the code point before the current position is encoded with.
+         */
+        std::size_t previous_length() const {
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                // find the lead byte of the last sequence, it is valid only if it ends right at the current position
+                const std::size_t max_back = std::min<std::size_t>(m_position - m_begin, 4);
+                for (std::size_t back = 1; back <= max_back; back++) {
+                    const char8_t byte = static_cast<char8_t>(m_position[-static_cast<std::ptrdiff_t>(back)]);
+                    if (byte >> 6 == constants::trailing_byte_marker) {
+                        continue;
+                    }
+                    const char8_t* it = reinterpret_cast<const char8_t*>(m_position - back);
+                    char32_t code_point = 0;
+                    if (back > 1 && decode_utf8(it, reinterpret_cast<const char8_t*>(m_end), code_point) == conversion::status_e::success &&
+                        it == reinterpret_cast<const char8_t*>(m_position)) {
+                        return back;
+                    }
+                    break;
+                }
+                return 1;
             }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                const bool pair = m_position - m_begin > 1 && is_low_surrogate(m_position[-1]) && is_high_surrogate(m_position[-2]);
+                return pair ? 2 : 1;
+            }
+            else {
+                return 1;
+            }
+        }
 
-            uint8_t  first_4_bits  =  cp_16 >> 12;
-            uint8_t  middle_6_bits = (cp_16 <<  4) >> 10;
-            uint8_t  last_6_bits   = (cp_16 << 10) >> 10;
+        const char_type* m_begin      = nullptr; /**< First code unit of the string. */
+        const char_type* m_end        = nullptr; /**< Past the last code unit of the string. */
+        const char_type* m_position   = nullptr; /**< First code unit of the current code point. */
+        std::size_t      m_length     = 0; /**< Number of code units of the current code point. */
+        char32_t         m_code_point = 0; /**< The current code point. */
+    };
 
-            result.push_back((triple_byte_marker   << 4) + first_4_bits);
-            result.push_back((trailing_byte_marker << 6) + middle_6_bits);
-            result.push_back((trailing_byte_marker << 6) + last_6_bits);
+    /**
+     * @brief Range of code points of a string, does not own the string.
+     *
+     * @tparam char_type type of code units (@c char8_t, @c char16_t or @c char32_t).
+     */
+    template <typename char_type>
+    class code_point_view {
+    public:
+        using iterator = code_point_iterator<char_type>;
 
-            continue;
+        code_point_view() = default;
+        explicit code_point_view(const std::basic_string_view<char_type>& sv)
+            : m_sv(sv) {
         }
-        if (this_code_point <= four_byte_boundary) {
-            uint8_t first_3_bits  =  this_code_point >> 18;
-            uint8_t second_6_bits = (this_code_point << 14) >> 26;
-            uint8_t third_6_bits  = (this_code_point << 20) >> 26;
-            uint8_t last_6_bits   = (this_code_point << 26) >> 26;
 
-            result.push_back((quadruple_byte_marker << 5) + first_3_bits);
-            result.push_back((trailing_byte_marker  << 6) + second_6_bits);
-            result.push_back((trailing_byte_marker  << 6) + third_6_bits);
-            result.push_back((trailing_byte_marker  << 6) + last_6_bits);
+        iterator begin() const {
+            return iterator(m_sv.data(), m_sv.data() + m_sv.size(), m_sv.data());
+        }
+        iterator end() const {
+            return iterator(m_sv.data(), m_sv.data() + m_sv.size(), m_sv.data() + m_sv.size());
+        }
+        bool empty() const {
+            return m_sv.empty();
+        }
 
-            continue;
+        /**
+         * @brief Returns the underlying string.
+         */
+        std::basic_string_view<char_type> base() const {
+            return m_sv;
+        }
+
+    private:
+        std::basic_string_view<char_type> m_sv; /**< The string code points are decoded from. */
+    };
+
+    /**
+     * @brief Bidirectional iterator over code units of a string converted to another encoding on the fly.
+     *
+     * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+     * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+     * @details
+     * Only the current code point is kept encoded, so nothing is allocated. Refer to code_point_iterator for the handling
+     * of malformed input.
+     */
+    template <typename to_type, typename from_type>
+    class transcode_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type        = to_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = to_type;
+
+        transcode_iterator() = default;
+
+        /**
+         * @brief Creates an iterator pointing to the first code unit of the code point @p it points to.
+         */
+        explicit transcode_iterator(const code_point_iterator<from_type>& it)
+            : m_it(it) {
+            encode();
         }
+
+        /**
+         * @brief Returns the current code unit.
+         */
+        to_type operator*() const {
+            return m_units[m_index];
+        }
+
+        transcode_iterator& operator++() {
+            if (++m_index == m_size) {
+                ++m_it;
+                encode();
+            }
+            return *this;
+        }
+        transcode_iterator operator++(int) {
+            transcode_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        transcode_iterator& operator--() {
+            if (m_index == 0) {
+                --m_it;
+                encode();
+                m_index = m_size;
+            }
+            m_index--;
+            return *this;
+        }
+        transcode_iterator operator--(int) {
+            transcode_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const transcode_iterator& other) const {
+            return m_it == other.m_it && m_index == other.m_index;
+        }
+        bool operator!=(const transcode_iterator& other) const {
+            return !(*this == other);
+        }
+
+        /**
+         * @brief Returns the iterator to the code point the current code unit belongs to.
+         */
+        const code_point_iterator<from_type>& base() const {
+            return m_it;
+        }
+
+    private:
+        /**
+         * @brief Encodes the current code point, moves to its first code unit.
+         */
+        void encode() {
+            m_index = 0;
+            m_size  = 0;
+            if (m_it.length() == 0) {
+                return;
+            }
+
+            if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                char8_t units[4] = {};
+                m_size = static_cast<std::size_t>(encode_utf8(*m_it, units) - units);
+                std::copy_n(units, m_size, m_units);
+            }
+            else if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                char16_t units[2] = {};
+                m_size = static_cast<std::size_t>(encode_utf16(*m_it, units) - units);
+                std::copy_n(units, m_size, m_units);
+            }
+            else {
+                m_units[0] = static_cast<to_type>(*m_it);
+                m_size     = 1;
+            }
+        }
+
+        code_point_iterator<from_type> m_it; /**< The current code point. */
+        to_type     m_units[4] = {}; /**< The current code point encoded. */
+        std::size_t m_size     = 0; /**< Number of code units in #m_units. */
+        std::size_t m_index    = 0; /**< Index of the current code unit in #m_units. */
+    };
+
+    /**
+     * @brief Range of code units of a string converted to another encoding on the fly, does not own the string.
+     *
+     * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+     * @tparam from_type type of input code units (@c char8_t, @c char16_t or @c char32_t).
+     * @remarks
+     * Useful when only a part of the result is needed, e.g. to compare a prefix or to feed another encoder, as the work
+     * is proportional to the number of code units actually read. Use conversion functions to convert whole strings, they are faster.
+     */
+    template <typename to_type, typename from_type>
+    class transcode_view {
+    public:
+        using iterator = transcode_iterator<to_type, from_type>;
+
+        transcode_view() = default;
+        explicit transcode_view(const std::basic_string_view<from_type>& sv)
+            : m_code_points(sv) {
+        }
+
+        iterator begin() const {
+            return iterator(m_code_points.begin());
+        }
+        iterator end() const {
+            return iterator(m_code_points.end());
+        }
+        bool empty() const {
+            return m_code_points.empty();
+        }
+
+        /**
+         * @brief Returns the underlying string.
+         */
+        std::basic_string_view<from_type> base() const {
+            return m_code_points.base();
+        }
+
+    private:
+        code_point_view<from_type> m_code_points; /**< Code points of the string. */
+    };
+
+    /**
+     * @brief Returns the range of code points of the string.
+     */
+    template <typename char_type>
+    code_point_view<char_type> code_points(const std::basic_string_view<char_type>& sv) {
+        return code_point_view<char_type>(sv);
     }
 
-    return status_e::success;
-}
+    /**
+     * @brief Returns the range of code units of the string converted to the encoding of @p to_type.
+     */
+    template <typename to_type, typename from_type>
+    transcode_view<to_type, from_type> transcode(const std::basic_string_view<from_type>& sv) {
+        return transcode_view<to_type, from_type>(sv);
+    }
+
+    /**
+     * @}
+     */
+
+    /**
+     * @namespace utf::literals
+     * @brief This namespace contains conversion of string literals at compile time.
+     */
+    namespace literals {
+        /**
+         * @addtogroup literal_funcs Literal Conversion Functions
+         * Functions used to convert string literals while compiling, so neither the conversion nor the allocation happens at run time.
+         * @{
+         */
+
+        /**
+         * @brief Holds a converted literal.
+         *
+         * @tparam char_type type of code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam length length of the string in code units, not counting the null terminator.
+         */
+        template <typename char_type, std::size_t length>
+        struct fixed_string_t {
+            std::array<char_type, length + 1> units = {}; /**< Code units of the string followed by the null terminator. */
+
+            /**
+             * @brief Returns a pointer to the null-terminated string.
+             */
+            constexpr const char_type* c_str() const {
+                return units.data();
+            }
+            /**
+             * @brief Returns the length of the string in code units, not counting the null terminator.
+             */
+            constexpr std::size_t size() const {
+                return length;
+            }
+            /**
+             * @brief Returns a view of the string.
+             */
+            constexpr std::basic_string_view<char_type> view() const {
+                return std::basic_string_view<char_type>(units.data(), length);
+            }
+            constexpr operator std::basic_string_view<char_type>() const {
+                return view();
+            }
+        };
+
+        /**
+         * @internal
+         * @brief Deliberately not @c constexpr, so reaching it makes the compile-time conversion ill-formed.
+         * @remarks
+         * The compiler reports the call of this function if the literal is malformed (or not standard-compliant when
+         * the conversion is strict), or if the length passed to convert() differs from converted_length().
+         */
+        inline void invalid_literal() {
+        }
+
+        /**
+         * @internal
+         * @brief Decodes the code point at the beginning of the string.
+         * @return the number of code units the code point is encoded with, at least 1.
+         * @remarks
+         * At run time a malformed code unit is decoded as constants::replacement_character, so the callers always make progress.
+         */
+        template <typename from_type>
+        constexpr std::size_t decode_literal(const from_type* in, const std::size_t size, char32_t& code_point, bool comply_with_standard) {
+            std::size_t units = 1;
+
+            if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                // u8 literals are arrays of char before C++20, so copy the sequence into bytes decode_utf8() accepts
+                char8_t bytes[4] = {};
+                const std::size_t available = std::min<std::size_t>(size, std::size(bytes));
+                for (std::size_t i = 0; i < available; i++) {
+                    bytes[i] = static_cast<char8_t>(in[i]);
+                }
+                const char8_t* it = bytes;
+                if (decode_utf8(it, bytes + available, code_point) < conversion::status_e::success) {
+                    invalid_literal();
+                    // called at run time the conversion goes on, so consume the byte as the views do
+                    code_point = constants::replacement_character;
+                    it++;
+                }
+                units = static_cast<std::size_t>(it - bytes);
+            }
+            else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                code_point = static_cast<char16_t>(in[0]);
+                if (is_high_surrogate(in[0]) && size > 1 && is_low_surrogate(in[1])) {
+                    code_point = ((in[0] - constants::high_surrogate_start) << 10) +
+                                 (in[1] - constants::low_surrogate_start)          +
+                                 constants::supplementary_plane_offset;
+                    units      = 2;
+                }
+            }
+            else {
+                code_point = static_cast<char32_t>(in[0]);
+                if (code_point > constants::four_byte_boundary) {
+                    invalid_literal();
+                    code_point = constants::replacement_character;
+                }
+            }
+
+            if (comply_with_standard && is_surrogate(code_point)) {
+                invalid_literal();
+            }
+            return units;
+        }
+
+        /**
+         * @brief Computes the length of the converted literal at compile time.
+         *
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+         * @param[in] literal string literal (@c u8, @c u or @c U).
+         * @param[in] comply_with_standard should the conversion comply with Unicode standard. Defaults to @c false.
+         * @return length of the converted string in code units, not counting the null terminator.
+         */
+        template <typename to_type, typename from_type, std::size_t from_size>
+        constexpr std::size_t converted_length(const from_type (&literal)[from_size], bool comply_with_standard = false) {
+            std::size_t length = 0;
+            // the last code unit of the literal is the null terminator
+            for (std::size_t i = 0; i + 1 < from_size;) {
+                char32_t code_point = 0;
+                i += decode_literal(literal + i, from_size - 1 - i, code_point, comply_with_standard);
+
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    length += utf8_sequence_length(code_point);
+                }
+                else if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                    length += utf16_sequence_length(code_point);
+                }
+                else {
+                    length++;
+                }
+            }
+            return length;
+        }
+
+        /**
+         * @brief Converts a string literal at compile time.
+         *
+         * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+         * @tparam length length of the converted string, must be equal to converted_length() of the same literal.
+         * @param[in] literal string literal (@c u8, @c u or @c U).
+         * @param[in] comply_with_standard should the conversion comply with Unicode standard. Defaults to @c false.
+         * @return the converted string specified by #fixed_string_t.
+         * @remarks
+         * The conversion follows the rules of the respective function in utf::conversion. Malformed literal does not compile
+         * when the result initializes a @c constexpr variable. Use #UTFUTILS_LITERAL to avoid spelling out the length.
+         * Called at run time, each malformed code unit is converted to constants::replacement_character instead.
+         */
+        template <typename to_type, std::size_t length, typename from_type, std::size_t from_size>
+        constexpr fixed_string_t<to_type, length> convert(const from_type (&literal)[from_size], bool comply_with_standard = false) {
+            fixed_string_t<to_type, length> result;
+            std::size_t written = 0;
 
+            for (std::size_t i = 0; i + 1 < from_size;) {
+                char32_t code_point = 0;
+                i += decode_literal(literal + i, from_size - 1 - i, code_point, comply_with_standard);
 
-#endif // defined IMPLEMENT_UTFUTILS
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    if (length - written < utf8_sequence_length(code_point)) {
+                        invalid_literal();
+                        return result;
+                    }
+                    written = static_cast<std::size_t>(encode_utf8(code_point, result.units.data() + written) - result.units.data());
+                }
+                else if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                    if (length - written < utf16_sequence_length(code_point)) {
+                        invalid_literal();
+                        return result;
+                    }
+                    written = static_cast<std::size_t>(encode_utf16(code_point, result.units.data() + written) - result.units.data());
+                }
+                else {
+                    if (written == length) {
+                        invalid_literal();
+                        return result;
+                    }
+                    result.units[written++] = code_point;
+                }
+            }
+
+            if (written != length) {
+                invalid_literal();
+            }
+            return result;
+        }
+
+#if __cplusplus >= 202002L // >= c++20
+        /**
+         * @internal
+         * @brief Copy of a string literal which can be passed as a template argument.
+         */
+        template <typename char_type, std::size_t size>
+        struct literal_source_t {
+            char_type units[size] = {};
+
+            constexpr literal_source_t(const char_type (&literal)[size]) {
+                std::copy_n(literal, size, units);
+            }
+        };
+#endif
+
+        /**
+         * @}
+         */
+    } // namespace literals
+
+#if __cplusplus >= 202002L // >= c++20
+    /**
+     * @brief String literal converted at compile time, e.g. @c utf::literal<char8_t,u"ключ">.
+     *
+     * @tparam to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+     * @tparam source string literal (@c u8, @c u or @c U).
+     * @remarks
+     * Lenient, as utf::conversion functions are by default. Refer to literals::convert() for details.
+     */
+    template <typename to_type, literals::literal_source_t source>
+    inline constexpr literals::fixed_string_t<to_type, literals::converted_length<to_type>(source.units)> literal =
+        literals::convert<to_type, literals::converted_length<to_type>(source.units)>(source.units);
+#endif
+} // namespace utf
+
+#if __cplusplus >= 202002L // >= c++20
+#include <ranges>
+
+// the views do not own the string, so they are cheap to copy and their iterators outlive them
+namespace std::ranges {
+    template <typename char_type>
+    inline constexpr bool enable_view<utf::code_point_view<char_type>> = true;
+    template <typename char_type>
+    inline constexpr bool enable_borrowed_range<utf::code_point_view<char_type>> = true;
+    template <typename to_type, typename from_type>
+    inline constexpr bool enable_view<utf::transcode_view<to_type, from_type>> = true;
+    template <typename to_type, typename from_type>
+    inline constexpr bool enable_borrowed_range<utf::transcode_view<to_type, from_type>> = true;
+} // namespace std::ranges
+#endif
+
+/**
+ * @brief Converts a string literal at compile time, e.g. @c UTFUTILS_LITERAL(char16_t,u8"ключ").
+ * @param to_type type of output code units (@c char8_t, @c char16_t or @c char32_t).
+ * @param literal string literal (@c u8, @c u or @c U).
+ * @return utf::literals::fixed_string_t holding the converted string.
+ * @remarks
+ * Lenient, as utf::conversion functions are by default. Malformed literal does not compile.
+ */
+#define UTFUTILS_LITERAL(to_type, literal) \
+    ([] { \
+        constexpr auto utfutils_literal = ::utf::literals::convert<to_type, ::utf::literals::converted_length<to_type>(literal)>(literal); \
+        return utfutils_literal; \
+    }())
+
+//--------------------------------------------------IMPLEMENTATION--------------------------------------------------//
+// Either compiled into utf-utils library, or included here to make the whole library header-only
+#if defined(UTFUTILS_HEADER_ONLY) || defined(IMPLEMENT_UTFUTILS)
+#   include "utf_utils_impl.hpp"
+#endif
 #endif // !defined(UTFUTILS_H)
\ No newline at end of file
@@ -0,0 +1,3143 @@
+#if !defined(UTFUTILS_IMPL_H)
+#   define UTFUTILS_IMPL_H
+
+/**
+ * @file utf_utils_impl.hpp
+ * @brief Definitions of the functions declared in utf_utils.hpp.
+ * @details
+ * Normally compiled once into utf-utils library. With @c UTFUTILS_HEADER_ONLY defined (in every translation unit of the
+ * program) utf_utils.hpp includes this file itself and all functions become inline, so the compiler can inline the
+ * conversions into the calling code.
+ */
+
+#include "utf_utils.hpp"
+
+#if defined(UTFUTILS_HEADER_ONLY)
+#   define UTFUTILS_INLINE inline
+#else
+#   define UTFUTILS_INLINE
+#endif
+
+// Standard library
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+// Intrinsics
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define UTFUTILS_X86
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+        // MSVC allows intrinsics of any instruction set in any function
+#       define UTFUTILS_TARGET_SSSE3
+#       define UTFUTILS_TARGET_SSE42
+#       define UTFUTILS_TARGET_AVX2
+#       define UTFUTILS_TARGET_AVX512
+#   else
+#       define UTFUTILS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#       define UTFUTILS_TARGET_SSE42 __attribute__((target("sse4.2")))
+#       define UTFUTILS_TARGET_AVX2 __attribute__((target("avx2")))
+#       define UTFUTILS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#   endif
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define UTFUTILS_SSE2
+#   endif
+#endif
+
+// Conversion loops are inlined into a function per tier, so they are compiled for the instruction set of each one
+#if defined(_MSC_VER) && !defined(__clang__)
+#   define UTFUTILS_ALWAYS_INLINE __forceinline
+#else
+#   define UTFUTILS_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace utf {
+    /**
+     * @internal
+     * @brief This namespace contains low-level conversion kernels and CPU features detection.
+     */
+    namespace kernels {
+        /**
+         * @internal
+         * @addtogroup kernels Kernels
+         * Low-level (and possibly vectorized) building blocks of conversion functions.
+         * @{
+         */
+        /**
+         * @internal
+         * @brief Number of #simd_tier_e values.
+         */
+        constexpr std::size_t simd_tier_count = static_cast<std::size_t>(simd_tier_e::avx512) + 1;
+
+        /**
+         * @internal
+         * @brief Detects the best tier the CPU (and the OS) supports.
+         */
+        inline simd_tier_e detect_simd_tier() {
+#if defined(UTFUTILS_X86)
+#   if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            const int max_leaf = info[0];
+            __cpuid(info, 1);
+            const bool sse2  = (info[3] & (1 << 26)) != 0;
+            const bool sse42 = (info[2] & (1 << 9)) && (info[2] & (1 << 19)) && (info[2] & (1 << 20));
+            // the OS has to save YMM (and ZMM) registers on context switches
+            const unsigned long long enabled_state = (info[2] & (1 << 27)) ? _xgetbv(0) : 0;
+            bool avx2   = false;
+            bool avx512 = false;
+            if (max_leaf >= 7) {
+                __cpuidex(info, 7, 0);
+                avx2   = (info[1] & (1 << 5)) && (enabled_state & 0x6) == 0x6;
+                avx512 = (info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (enabled_state & 0xE6) == 0xE6;
+            }
+#   else
+            __builtin_cpu_init();
+            const bool sse2   = __builtin_cpu_supports("sse2");
+            const bool sse42  = __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("sse4.2");
+            const bool avx2   = __builtin_cpu_supports("avx2");
+            const bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#   endif
+            if (!sse2) {
+                return simd_tier_e::scalar;
+            }
+            if (!sse42) {
+                return simd_tier_e::sse2;
+            }
+            if (!avx2) {
+                return simd_tier_e::sse42;
+            }
+            return avx512 ? simd_tier_e::avx512 : simd_tier_e::avx2;
+#else
+            return simd_tier_e::scalar;
+#endif
+        }
+        /**
+         * @internal
+         * @brief Picks the tier to start with: the one set by @c UTFUTILS_SIMD_TIER environment variable (if supported) or the best one.
+         */
+        inline simd_tier_e initial_simd_tier() {
+            static constexpr const char* names[simd_tier_count] = { "scalar", "sse2", "sse42", "avx2", "avx512" };
+
+            const simd_tier_e supported = supported_simd_tier();
+            const char* forced = std::getenv("UTFUTILS_SIMD_TIER");
+            if (forced != nullptr) {
+                for (std::size_t tier = 0; tier < simd_tier_count; tier++) {
+                    if (std::strcmp(forced, names[tier]) == 0) {
+                        return std::min(static_cast<simd_tier_e>(tier), supported);
+                    }
+                }
+            }
+            return supported;
+        }
+        /**
+         * @internal
+         * @brief Holds the tier all dispatch tables pick kernels of.
+         */
+        inline std::atomic<simd_tier_e>& simd_tier_state() {
+            static std::atomic<simd_tier_e> tier{ initial_simd_tier() };
+            return tier;
+        }
+
+        /**
+         * @internal
+         * @brief Holds the best kernel of every tier, so switching tiers is just a store.
+         * @tparam kernel_type type of pointer to the kernel.
+         * @details
+         * Kernels are picked once, when the table is built (on the first call of the function holding it as a static variable),
+         * every call only loads the active tier.
+         */
+        template <typename kernel_type>
+        class dispatch_table_t {
+        public:
+            /**
+             * @brief Fills the table.
+             * @param[in] select function returning the best kernel not above the given tier.
+             */
+            template <typename selector_type>
+            explicit dispatch_table_t(const selector_type& select) {
+                for (std::size_t tier = 0; tier < simd_tier_count; tier++) {
+                    m_kernels[tier] = select(static_cast<simd_tier_e>(tier));
+                }
+            }
+
+            /**
+             * @brief Calls the kernel of the active tier.
+             */
+            template <typename... argument_types>
+            auto operator()(argument_types... arguments) const {
+                return m_kernels[static_cast<std::size_t>(simd_tier_state().load(std::memory_order_relaxed))](arguments...);
+            }
+
+        private:
+            kernel_type m_kernels[simd_tier_count];
+        };
+
+        /**
+         * @internal
+         * @brief Returns the index of the lowest set bit.
+         * @param mask Non-zero value.
+         */
+        inline uint32_t count_trailing_zeros(const uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+        /**
+         * @internal
+         * @brief Returns the index of the lowest set bit.
+         * @param mask Non-zero value.
+         */
+        inline uint32_t count_trailing_zeros(const uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+#   if defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return index;
+#   else
+            const uint32_t low = static_cast<uint32_t>(mask);
+            return low != 0 ? count_trailing_zeros(low) : 32 + count_trailing_zeros(static_cast<uint32_t>(mask >> 32));
+#   endif
+#else
+            return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+        }
+        /**
+         * @internal
+         * @brief Returns the number of set bits.
+         * @remark Compiles to @c popcnt, only call it from the kernels of tiers which have it (SSE4.2 and above).
+         */
+        inline uint32_t count_ones(const uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            return __popcnt(mask);
+#else
+            return static_cast<uint32_t>(__builtin_popcount(mask));
+#endif
+        }
+
+        /**
+         * @internal
+         * @brief Code unit of a byte stream, which may lie anywhere in memory.
+         * @details
+         * A pointer to it walks the bytes by code units without requiring the alignment of @c char16_t or @c char32_t, so byte
+         * streams go through the same kernels as strings. It is only ever read with load_unit() and unaligned vector loads.
+         */
+        template <typename char_type>
+        struct unaligned_unit_t {
+            unsigned char bytes[sizeof(char_type)];
+        };
+        /**
+         * @internal
+         * @brief Type of the code unit value read from @p unit_type.
+         */
+        template <typename unit_type>
+        struct native_unit {
+            using type = unit_type;
+        };
+        template <typename char_type>
+        struct native_unit<unaligned_unit_t<char_type>> {
+            using type = char_type;
+        };
+        template <typename unit_type>
+        using native_unit_t = typename native_unit<unit_type>::type;
+
+        /**
+         * @internal
+         * @brief Reads a code unit, possibly from unaligned memory.
+         * @tparam swap_input should the bytes of the code unit be reversed (the string is not in the native byte order).
+         */
+        template <bool swap_input, typename unit_type>
+        native_unit_t<unit_type> load_unit(const unit_type* in) {
+            using char_type = native_unit_t<unit_type>;
+            char_type unit;
+            std::memcpy(&unit, in, sizeof(char_type));
+            if constexpr (swap_input && sizeof(char_type) == sizeof(char16_t)) {
+                unit = static_cast<char_type>(unit >> 8 | unit << 8);
+            }
+            else if constexpr (swap_input && sizeof(char_type) == sizeof(char32_t)) {
+                unit = static_cast<char_type>(unit >> 24 | (unit >> 8 & 0xFF00) | (unit << 8 & 0xFF0000) | unit << 24);
+            }
+            return unit;
+        }
+
+        /**
+         * @internal
+         * @brief Copies ASCII characters one by one.
+         * @remark Used as a fallback when no vectorized kernel is available.
+         */
+        template <typename from_type, typename to_type, bool swap_input = false>
+        std::size_t copy_ascii_scalar(const from_type* in, const std::size_t size, to_type* out) {
+            std::size_t i = 0;
+            for (; i < size && load_unit<swap_input>(in + i) <= constants::one_byte_boundary; i++) {
+                out[i] = static_cast<to_type>(load_unit<swap_input>(in + i));
+            }
+            return i;
+        }
+
+#if defined(UTFUTILS_SSE2)
+        /**
+         * @internal
+         * @brief Loads 16 bytes of UTF-16 or UTF-32 code units, reversing the bytes of each one if needed.
+         * @details
+         * SSE2 has no byte shuffle, so bytes are swapped with shifts (and 16-bit halves of UTF-32 code units with word shuffles).
+         */
+        template <bool swap_input, typename char_type>
+        __m128i load_units_sse2(const char_type* in) {
+            const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            if constexpr (!swap_input) {
+                return units;
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                return _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+            }
+            else {
+                const __m128i halves = _mm_shufflehi_epi16(_mm_shufflelo_epi16(units, 0xB1), 0xB1);
+                return _mm_or_si128(_mm_slli_epi16(halves, 8), _mm_srli_epi16(halves, 8));
+            }
+        }
+
+        /**
+         * @internal
+         * @brief SSE2 kernel copying ASCII characters 16 at a time.
+         * @details
+         * Code units are first narrowed to bytes (exactly for ASCII ones, anyhow for the rest), then widened to output code units.
+         */
+        template <typename from_type, typename to_type, bool swap_input = false>
+        std::size_t copy_ascii_sse2(const from_type* in, const std::size_t size, to_type* out) {
+            const __m128i zero = _mm_setzero_si128();
+
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                __m128i bytes;
+                uint32_t non_ascii_mask;
+                if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                    bytes          = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    non_ascii_mask = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+                }
+                else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                    const __m128i non_ascii_bits = _mm_set1_epi16(static_cast<short>(0xFF80));
+                    const __m128i units_0        = load_units_sse2<swap_input>(in + i);
+                    const __m128i units_1        = load_units_sse2<swap_input>(in + i + 8);
+                    const __m128i ascii          = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(units_0, non_ascii_bits), zero),
+                                                                   _mm_cmpeq_epi16(_mm_and_si128(units_1, non_ascii_bits), zero));
+                    bytes          = _mm_packus_epi16(units_0, units_1);
+                    non_ascii_mask = ~static_cast<uint32_t>(_mm_movemask_epi8(ascii)) & 0xFFFF;
+                }
+                else {
+                    const __m128i non_ascii_bits = _mm_set1_epi32(static_cast<int>(0xFFFFFF80u));
+                    const __m128i units_0        = load_units_sse2<swap_input>(in + i);
+                    const __m128i units_1        = load_units_sse2<swap_input>(in + i + 4);
+                    const __m128i units_2        = load_units_sse2<swap_input>(in + i + 8);
+                    const __m128i units_3        = load_units_sse2<swap_input>(in + i + 12);
+                    const __m128i ascii_0_1      = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(units_0, non_ascii_bits), zero),
+                                                                   _mm_cmpeq_epi32(_mm_and_si128(units_1, non_ascii_bits), zero));
+                    const __m128i ascii_2_3      = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(units_2, non_ascii_bits), zero),
+                                                                   _mm_cmpeq_epi32(_mm_and_si128(units_3, non_ascii_bits), zero));
+                    bytes          = _mm_packus_epi16(_mm_packs_epi32(units_0, units_1), _mm_packs_epi32(units_2, units_3));
+                    non_ascii_mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(ascii_0_1, ascii_2_3))) & 0xFFFF;
+                }
+
+                // store all 16 characters even if some are not ASCII, the caller will overwrite them
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+                }
+                else {
+                    const __m128i low  = _mm_unpacklo_epi8(bytes, zero);
+                    const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                    if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),     low);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), high);
+                    }
+                    else {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),      _mm_unpacklo_epi16(low,  zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4),  _mm_unpackhi_epi16(low,  zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),  _mm_unpacklo_epi16(high, zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_unpackhi_epi16(high, zero));
+                    }
+                }
+
+                if (non_ascii_mask != 0) {
+                    return i + count_trailing_zeros(non_ascii_mask);
+                }
+            }
+            return i;
+        }
+#endif
+
+#if defined(UTFUTILS_X86)
+        /**
+         * @internal
+         * @brief Copies a 128-bit vector into all 4 lanes of a 512-bit one.
+         * @remark GCC 12 builds many AVX-512 intrinsics (broadcasts, truncations, widenings, lane extractions and insertions,
+         * reductions) on an uninitialized placeholder and warns about it in every caller (bug 105593). The AVX-512 kernels use
+         * the zero-masking forms with all lanes enabled instead, they compile to the same instructions without one (and an
+         * extraction of the lowest lane to no instruction at all, as the casts do).
+         */
+        UTFUTILS_TARGET_AVX512 inline __m512i broadcast_lane_avx512(const __m128i lane) {
+            return _mm512_maskz_broadcast_i32x4(0xFFFF, lane);
+        }
+        /**
+         * @internal
+         * @brief Sums 32-bit lanes of a 512-bit vector, the sum must fit in 32 bits.
+         * @remark Replaces _mm512_reduce_add_epi32(), see broadcast_lane_avx512() for the reason.
+         */
+        UTFUTILS_TARGET_AVX512 inline uint32_t reduce_add_avx512(const __m512i values) {
+            const __m256i halves = _mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xF, values, 0), _mm512_maskz_extracti64x4_epi64(0xF, values, 1));
+            __m128i       sum    = _mm_add_epi32(_mm256_castsi256_si128(halves), _mm256_extracti128_si256(halves, 1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+        }
+        /**
+         * @internal
+         * @brief Mask of byte shuffle which reverses the bytes of each UTF-16 or UTF-32 code unit in 128-bit lane.
+         */
+        template <typename char_type>
+        UTFUTILS_TARGET_SSSE3 inline __m128i byte_swap_mask() {
+            if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            }
+            else {
+                return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            }
+        }
+        /**
+         * @internal
+         * @brief Loads 16 bytes of UTF-16 or UTF-32 code units, reversing the bytes of each one with a byte shuffle if needed.
+         */
+        template <bool swap_input, typename char_type>
+        UTFUTILS_TARGET_SSSE3 inline __m128i load_units_ssse3(const char_type* in) {
+            const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            if constexpr (swap_input) {
+                return _mm_shuffle_epi8(units, byte_swap_mask<char_type>());
+            }
+            else {
+                return units;
+            }
+        }
+        /**
+         * @internal
+         * @brief Loads 32 bytes of UTF-16 or UTF-32 code units, reversing the bytes of each one if needed.
+         */
+        template <bool swap_input, typename char_type>
+        UTFUTILS_TARGET_AVX2 inline __m256i load_units_avx2(const char_type* in) {
+            const __m256i units = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+            if constexpr (swap_input) {
+                return _mm256_shuffle_epi8(units, _mm256_broadcastsi128_si256(byte_swap_mask<char_type>()));
+            }
+            else {
+                return units;
+            }
+        }
+        /**
+         * @internal
+         * @brief Loads 64 bytes of UTF-16 or UTF-32 code units, reversing the bytes of each one if needed.
+         */
+        template <bool swap_input, typename char_type>
+        UTFUTILS_TARGET_AVX512 inline __m512i load_units_avx512(const char_type* in) {
+            const __m512i units = _mm512_loadu_si512(in);
+            if constexpr (swap_input) {
+                return _mm512_shuffle_epi8(units, broadcast_lane_avx512(byte_swap_mask<char_type>()));
+            }
+            else {
+                return units;
+            }
+        }
+
+        /**
+         * @internal
+         * @brief SSE4.1 kernel copying ASCII characters 16 at a time.
+         * @details
+         * Code units are clamped to 0xFF with unsigned minimum before narrowing, so the narrowed bytes are exact for ASCII code
+         * units and have the high bit set for the rest: one sign mask of the bytes tells both apart. Output code units are
+         * zero-extended from the bytes.
+         */
+        template <typename from_type, typename to_type, bool swap_input = false>
+        UTFUTILS_TARGET_SSE42 std::size_t copy_ascii_sse42(const from_type* in, const std::size_t size, to_type* out) {
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                __m128i bytes;
+                if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                    bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                }
+                else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                    const __m128i byte_max = _mm_set1_epi16(0xFF);
+                    bytes = _mm_packus_epi16(_mm_min_epu16(load_units_ssse3<swap_input>(in + i),     byte_max),
+                                             _mm_min_epu16(load_units_ssse3<swap_input>(in + i + 8), byte_max));
+                }
+                else {
+                    const __m128i byte_max  = _mm_set1_epi32(0xFF);
+                    const __m128i units_0_1 = _mm_packus_epi32(_mm_min_epu32(load_units_ssse3<swap_input>(in + i),      byte_max),
+                                                               _mm_min_epu32(load_units_ssse3<swap_input>(in + i + 4),  byte_max));
+                    const __m128i units_2_3 = _mm_packus_epi32(_mm_min_epu32(load_units_ssse3<swap_input>(in + i + 8),  byte_max),
+                                                               _mm_min_epu32(load_units_ssse3<swap_input>(in + i + 12), byte_max));
+                    bytes = _mm_packus_epi16(units_0_1, units_2_3);
+                }
+
+                // store all 16 characters even if some are not ASCII, the caller will overwrite them
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+                }
+                else if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),     _mm_cvtepu8_epi16(bytes));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8)));
+                }
+                else {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),      _mm_cvtepu8_epi32(bytes));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4),  _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),  _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12)));
+                }
+
+                const uint32_t non_ascii_mask = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+                if (non_ascii_mask != 0) {
+                    return i + count_trailing_zeros(non_ascii_mask);
+                }
+            }
+            return i;
+        }
+
+        /**
+         * @internal
+         * @brief AVX2 kernel copying ASCII characters 32 at a time.
+         * @remark Same algorithm as copy_ascii_sse2(), see it for details.
+         */
+        template <typename from_type, typename to_type, bool swap_input = false>
+        UTFUTILS_TARGET_AVX2 std::size_t copy_ascii_avx2(const from_type* in, const std::size_t size, to_type* out) {
+            const __m256i zero = _mm256_setzero_si256();
+
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                __m256i bytes;
+                uint32_t non_ascii_mask;
+                if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                    bytes          = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                    non_ascii_mask = static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+                }
+                else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                    const __m256i non_ascii_bits = _mm256_set1_epi16(static_cast<short>(0xFF80));
+                    const __m256i units_0        = load_units_avx2<swap_input>(in + i);
+                    const __m256i units_1        = load_units_avx2<swap_input>(in + i + 16);
+                    const __m256i ascii          = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(units_0, non_ascii_bits), zero),
+                                                                      _mm256_cmpeq_epi16(_mm256_and_si256(units_1, non_ascii_bits), zero));
+                    // packing works within 128-bit lanes, so quarters of the result are interleaved
+                    bytes          = _mm256_permute4x64_epi64(_mm256_packus_epi16(units_0, units_1), 0xD8);
+                    non_ascii_mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_permute4x64_epi64(ascii, 0xD8)));
+                }
+                else {
+                    const __m256i non_ascii_bits = _mm256_set1_epi32(static_cast<int>(0xFFFFFF80u));
+                    const __m256i order          = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+                    const __m256i units_0        = load_units_avx2<swap_input>(in + i);
+                    const __m256i units_1        = load_units_avx2<swap_input>(in + i + 8);
+                    const __m256i units_2        = load_units_avx2<swap_input>(in + i + 16);
+                    const __m256i units_3        = load_units_avx2<swap_input>(in + i + 24);
+                    const __m256i ascii_0_1      = _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(units_0, non_ascii_bits), zero),
+                                                                      _mm256_cmpeq_epi32(_mm256_and_si256(units_1, non_ascii_bits), zero));
+                    const __m256i ascii_2_3      = _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(units_2, non_ascii_bits), zero),
+                                                                      _mm256_cmpeq_epi32(_mm256_and_si256(units_3, non_ascii_bits), zero));
+                    // packing works within 128-bit lanes, so 4-byte groups of the result are interleaved
+                    bytes          = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(_mm256_packs_epi32(units_0, units_1), _mm256_packs_epi32(units_2, units_3)), order);
+                    non_ascii_mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_permutevar8x32_epi32(_mm256_packs_epi16(ascii_0_1, ascii_2_3), order)));
+                }
+
+                // store all 32 characters even if some are not ASCII, the caller will overwrite them
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), bytes);
+                }
+                else {
+                    const __m128i low  = _mm256_castsi256_si128(bytes);
+                    const __m128i high = _mm256_extracti128_si256(bytes, 1);
+                    if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),      _mm256_cvtepu8_epi16(low));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), _mm256_cvtepu8_epi16(high));
+                    }
+                    else {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),      _mm256_cvtepu8_epi32(low));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 8),  _mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), _mm256_cvtepu8_epi32(high));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 24), _mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+                    }
+                }
+
+                if (non_ascii_mask != 0) {
+                    return i + count_trailing_zeros(non_ascii_mask);
+                }
+            }
+            return i;
+        }
+
+        /**
+         * @internal
+         * @brief AVX-512 kernel copying ASCII characters 64 at a time.
+         * @remark Same algorithm as copy_ascii_sse2(), see it for details.
+         */
+        template <typename from_type, typename to_type, bool swap_input = false>
+        UTFUTILS_TARGET_AVX512 std::size_t copy_ascii_avx512(const from_type* in, const std::size_t size, to_type* out) {
+            std::size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                __m512i bytes;
+                uint64_t non_ascii_mask;
+                if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                    bytes          = _mm512_loadu_si512(in + i);
+                    non_ascii_mask = _mm512_movepi8_mask(bytes);
+                }
+                else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                    const __m512i non_ascii_bits = _mm512_set1_epi16(static_cast<short>(0xFF80));
+                    const __m512i units_0        = load_units_avx512<swap_input>(in + i);
+                    const __m512i units_1        = load_units_avx512<swap_input>(in + i + 32);
+                    // zero-masking forms with all lanes enabled, see broadcast_lane_avx512()
+                    bytes          = _mm512_maskz_inserti64x4(0xFF, _mm512_castsi256_si512(_mm512_maskz_cvtepi16_epi8(~0u, units_0)),
+                                                              _mm512_maskz_cvtepi16_epi8(~0u, units_1), 1);
+                    non_ascii_mask = static_cast<uint64_t>(_mm512_test_epi16_mask(units_0, non_ascii_bits)) |
+                                     static_cast<uint64_t>(_mm512_test_epi16_mask(units_1, non_ascii_bits)) << 32;
+                }
+                else {
+                    const __m512i non_ascii_bits = _mm512_set1_epi32(static_cast<int>(0xFFFFFF80u));
+                    const __m512i units_0        = load_units_avx512<swap_input>(in + i);
+                    const __m512i units_1        = load_units_avx512<swap_input>(in + i + 16);
+                    const __m512i units_2        = load_units_avx512<swap_input>(in + i + 32);
+                    const __m512i units_3        = load_units_avx512<swap_input>(in + i + 48);
+                    bytes          = _mm512_castsi128_si512(_mm512_maskz_cvtepi32_epi8(0xFFFF, units_0));
+                    bytes          = _mm512_inserti32x4(bytes, _mm512_maskz_cvtepi32_epi8(0xFFFF, units_1), 1);
+                    bytes          = _mm512_inserti32x4(bytes, _mm512_maskz_cvtepi32_epi8(0xFFFF, units_2), 2);
+                    bytes          = _mm512_inserti32x4(bytes, _mm512_maskz_cvtepi32_epi8(0xFFFF, units_3), 3);
+                    non_ascii_mask = static_cast<uint64_t>(_mm512_test_epi32_mask(units_0, non_ascii_bits))       |
+                                     static_cast<uint64_t>(_mm512_test_epi32_mask(units_1, non_ascii_bits)) << 16 |
+                                     static_cast<uint64_t>(_mm512_test_epi32_mask(units_2, non_ascii_bits)) << 32 |
+                                     static_cast<uint64_t>(_mm512_test_epi32_mask(units_3, non_ascii_bits)) << 48;
+                }
+
+                // store all 64 characters even if some are not ASCII, the caller will overwrite them
+                if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+                    _mm512_storeu_si512(out + i, bytes);
+                }
+                else if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                    _mm512_storeu_si512(out + i,      _mm512_cvtepu8_epi16(_mm512_maskz_extracti64x4_epi64(0xF, bytes, 0)));
+                    _mm512_storeu_si512(out + i + 32, _mm512_cvtepu8_epi16(_mm512_maskz_extracti64x4_epi64(0xF, bytes, 1)));
+                }
+                else {
+                    _mm512_storeu_si512(out + i,      _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm512_maskz_extracti32x4_epi32(0xF, bytes, 0)));
+                    _mm512_storeu_si512(out + i + 16, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm512_maskz_extracti32x4_epi32(0xF, bytes, 1)));
+                    _mm512_storeu_si512(out + i + 32, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm512_maskz_extracti32x4_epi32(0xF, bytes, 2)));
+                    _mm512_storeu_si512(out + i + 48, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm512_maskz_extracti32x4_epi32(0xF, bytes, 3)));
+                }
+
+                if (non_ascii_mask != 0) {
+                    return i + count_trailing_zeros(non_ascii_mask);
+                }
+            }
+            return i;
+        }
+#endif
+
+        /**
+         * @internal
+         * @brief Copies leading ASCII characters of a string into a string of another encoding with the best kernel of the tier.
+         * @tparam tier tier of the conversion loop calling it.
+         * @tparam from_type type of input code units.
+         * @tparam to_type type of output code units.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         * @details
+         * The kernel stops at the first non-ASCII code unit or when less than one block of input is left, so the caller has to
+         * handle the rest. Kernel may write up to one block of garbage past the returned count, though never past @c size units.
+         */
+        template <simd_tier_e tier, typename from_type, typename to_type, bool swap_input = false>
+        UTFUTILS_ALWAYS_INLINE std::size_t copy_ascii(const from_type* in, const std::size_t size, to_type* out) {
+#if defined(UTFUTILS_X86)
+            if constexpr (tier >= simd_tier_e::avx512) {
+                return copy_ascii_avx512<from_type, to_type, swap_input>(in, size, out);
+            }
+            if constexpr (tier >= simd_tier_e::avx2) {
+                return copy_ascii_avx2<from_type, to_type, swap_input>(in, size, out);
+            }
+            if constexpr (tier >= simd_tier_e::sse42) {
+                return copy_ascii_sse42<from_type, to_type, swap_input>(in, size, out);
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if constexpr (tier >= simd_tier_e::sse2) {
+                return copy_ascii_sse2<from_type, to_type, swap_input>(in, size, out);
+            }
+#endif
+            return copy_ascii_scalar<from_type, to_type, swap_input>(in, size, out);
+        }
+
+#if defined(UTFUTILS_SSE2)
+        /**
+         * @internal
+         * @brief Checks if 16 bytes are all ASCII characters.
+         */
+        inline bool is_ascii_vector_sse2(const char8_t* in) {
+            return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))) == 0;
+        }
+#endif
+#if defined(UTFUTILS_X86)
+        /**
+         * @internal
+         * @brief Checks if 32 bytes are all ASCII characters.
+         */
+        UTFUTILS_TARGET_AVX2 inline bool is_ascii_vector_avx2(const char8_t* in) {
+            return _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in))) == 0;
+        }
+        /**
+         * @internal
+         * @brief Checks if 64 bytes are all ASCII characters.
+         */
+        UTFUTILS_TARGET_AVX512 inline bool is_ascii_vector_avx512(const char8_t* in) {
+            return _mm512_movepi8_mask(_mm512_loadu_si512(in)) == 0;
+        }
+#endif
+
+        /**
+         * @internal
+         * @brief Checks if UTF-8 string starts with a whole block of ASCII characters for the ASCII kernel of the tier.
+         * @param size number of bytes which may be read (and written by the kernel).
+         * @details
+         * Calling the vectorized kernel costs more than copying a few characters, so shorter runs are better copied right away
+         * (or decoded along with the characters around them).
+         */
+        template <simd_tier_e tier>
+        UTFUTILS_ALWAYS_INLINE bool starts_with_ascii_vector([[maybe_unused]] const char8_t* in, [[maybe_unused]] const std::size_t size) {
+#if defined(UTFUTILS_X86)
+            if constexpr (tier >= simd_tier_e::avx512) {
+                return size >= 64 && is_ascii_vector_avx512(in);
+            }
+            if constexpr (tier >= simd_tier_e::avx2) {
+                return size >= 32 && is_ascii_vector_avx2(in);
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if constexpr (tier >= simd_tier_e::sse2) {
+                return size >= 16 && is_ascii_vector_sse2(in);
+            }
+#endif
+            // the scalar copy is a plain loop, inlined, so any run is worth handing over
+            return size > 0;
+        }
+
+        /**
+         * @internal
+         * @brief Encodes a single code point as UTF-8, UTF-16 or UTF-32 sequence.
+         * @tparam char_type type of output code units.
+         * @return pointer past the last written code unit.
+         */
+        template <typename char_type>
+        constexpr char_type* encode(const char32_t code_point, char_type* out) {
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                return encode_utf8(code_point, out);
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                return encode_utf16(code_point, out);
+            }
+            else {
+                *out++ = code_point;
+                return out;
+            }
+        }
+        /**
+         * @internal
+         * @brief Computes the number of code units the code point is encoded with.
+         * @tparam char_type type of output code units.
+         */
+        template <typename char_type>
+        constexpr std::size_t sequence_length(const char32_t code_point) {
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                return utf8_sequence_length(code_point);
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                return utf16_sequence_length(code_point);
+            }
+            else {
+                return 1;
+            }
+        }
+
+        /**
+         * @internal
+         * @brief Computes the length of the maximal subpart of an ill-formed UTF-8 sequence.
+         * @param[in] it pointer to the first byte of the sequence.
+         * @param[in] end pointer past the last byte of the string.
+         * @details
+         * The subpart is the longest prefix of a well-formed sequence (at least one byte), so each error is replaced with
+         * exactly one replacement character, as the Unicode standard recommends. Surrogates encoded in UTF-8 are ill-formed.
+         */
+        constexpr std::size_t utf8_error_length(const char8_t* it, const char8_t* end) {
+            const char8_t lead_byte = *it;
+            std::size_t   length    = 0;
+            // the range of the second byte narrows for some lead bytes, to exclude overlong forms, surrogates and code points above U+10FFFF
+            char8_t       lower     = 0x80;
+            char8_t       upper     = 0xBF;
+
+            if (lead_byte >= 0xC2 && lead_byte <= 0xDF) {
+                length = 2;
+            }
+            else if (lead_byte >= 0xE0 && lead_byte <= 0xEF) {
+                length = 3;
+                lower  = lead_byte == 0xE0 ? 0xA0 : lower;
+                upper  = lead_byte == 0xED ? 0x9F : upper;
+            }
+            else if (lead_byte >= 0xF0 && lead_byte <= 0xF4) {
+                length = 4;
+                lower  = lead_byte == 0xF0 ? 0x90 : lower;
+                upper  = lead_byte == 0xF4 ? 0x8F : upper;
+            }
+            else {
+                return 1;
+            }
+
+            std::size_t i = 1;
+            if (it + i < end && it[i] >= lower && it[i] <= upper) {
+                i++;
+                while (i < length && it + i < end && it[i] >> 6 == constants::trailing_byte_marker) {
+                    i++;
+                }
+            }
+            return i;
+        }
+
+#if defined(UTFUTILS_X86)
+        template <simd_tier_e tier, typename char_type, bool comply_with_standard>
+        UTFUTILS_ALWAYS_INLINE std::size_t decode_utf8_vectors(const char8_t* in, const char8_t* end, const char8_t*& valid_end, char_type* out, std::size_t capacity, std::size_t& written);
+#endif
+
+        /**
+         * @internal
+         * @brief Loop converting UTF-8 string to either UTF-16 or UTF-32 string, inlined into the function of each tier.
+         * @tparam tier tier the loop is compiled for.
+         * @tparam char_type type of output code units (@c char16_t or @c char32_t).
+         * @tparam policy what to do with ill-formed input.
+         * @details
+         * Runs of ASCII characters at least a vector long are handed over to the vectorized kernel. From SSE4.2 up, the string is
+         * validated a window at a time ahead of the conversion and well-formed windows are decoded a vector at a time. Everything
+         * else (short ASCII runs on lower tiers, ill-formed sequences and their surroundings) is decoded one sequence at a time.
+         */
+        template <simd_tier_e tier, typename char_type, conversion::error_policy_e policy>
+        UTFUTILS_ALWAYS_INLINE conversion::conversion_result_t utf8_to_utf_loop(const char8_t* in, const std::size_t size, char_type* out, const std::size_t capacity) {
+            using conversion::error_policy_e;
+
+            const char8_t*   it           = in;
+            const char8_t*   end          = in + size;
+            char_type*       out_it       = out;
+            char_type* const out_end      = out + capacity;
+            std::size_t      replacements = 0;
+
+            // bytes before it are known to be well-formed
+            [[maybe_unused]] const char8_t* valid_end = in;
+
+            const auto result = [&](const conversion::status_e status) {
+                return conversion::conversion_result_t{ status, static_cast<std::size_t>(it - in), static_cast<std::size_t>(out_it - out), replacements };
+            };
+
+            while (it < end) {
+                // the kernel may write a whole vector past the last ASCII character, so it must fit in both strings
+                const std::size_t max_size = std::min<std::size_t>(end - it, out_end - out_it);
+                if (*it <= constants::one_byte_boundary && starts_with_ascii_vector<tier>(it, max_size)) {
+                    const std::size_t copied = copy_ascii<tier, char8_t, char_type>(it, max_size, out_it);
+                    it     += copied;
+                    out_it += copied;
+                    continue;
+                }
+#if defined(UTFUTILS_X86)
+                if constexpr (tier >= simd_tier_e::sse42) {
+                    std::size_t written = 0;
+                    const std::size_t decoded = decode_utf8_vectors<tier, char_type, policy != error_policy_e::pass_through>(it, end, valid_end, out_it, out_end - out_it, written);
+                    it     += decoded;
+                    out_it += written;
+                    if (decoded > 0) {
+                        continue;
+                    }
+                }
+#endif
+                if (*it <= constants::one_byte_boundary) {
+                    if (out_it == out_end) {
+                        return result(conversion::status_e::output_too_small);
+                    }
+                    *out_it++ = *it++;
+                    continue;
+                }
+
+                const char8_t* sequence_end = it;
+                char32_t code_point = 0;
+                conversion::status_e status = decode_utf8(sequence_end, end, code_point);
+                if constexpr (policy != error_policy_e::pass_through) {
+                    if (status == conversion::status_e::success && is_surrogate(code_point)) {
+                        status = conversion::status_e::non_standard_encoding;
+                    }
+                }
+
+                bool replaced = false;
+                if (status < conversion::status_e::success) {
+                    if constexpr (policy == error_policy_e::strict || policy == error_policy_e::pass_through) {
+                        return result(status);
+                    }
+                    else if constexpr (policy == error_policy_e::skip) {
+                        it += utf8_error_length(it, end);
+                        replacements++;
+                        continue;
+                    }
+                    else {
+                        sequence_end = it + utf8_error_length(it, end);
+                        code_point   = constants::replacement_character;
+                        replaced     = true;
+                    }
+                }
+                if (static_cast<std::size_t>(out_end - out_it) < sequence_length<char_type>(code_point)) {
+                    return result(conversion::status_e::output_too_small);
+                }
+
+                out_it        = encode(code_point, out_it);
+                it            = sequence_end;
+                replacements += replaced;
+            }
+
+            return result(conversion::status_e::success);
+        }
+
+        /**
+         * @internal
+         * @brief Loop converting UTF-16 string to either UTF-8 or UTF-32 string, inlined into the function of each tier.
+         * @tparam tier tier the loop is compiled for.
+         * @tparam char_type type of output code units (@c char8_t or @c char32_t).
+         * @tparam policy what to do with ill-formed input.
+         * @tparam swap_input should the bytes of input code units be reversed (the string is not in the native byte order).
+         * @tparam unit_type type of input code units, @c char16_t or unaligned_unit_t of it for byte streams.
+         * @details
+         * Runs of ASCII characters are handed over to the vectorized kernel, everything else is converted one code point at a time.
+         */
+        template <simd_tier_e tier, typename char_type, conversion::error_policy_e policy, bool swap_input, typename unit_type>
+        UTFUTILS_ALWAYS_INLINE conversion::conversion_result_t utf16_to_utf_loop(const unit_type* in, const std::size_t size, char_type* out, const std::size_t capacity) {
+            using conversion::error_policy_e;
+
+            const unit_type* it           = in;
+            const unit_type* end          = in + size;
+            char_type*       out_it       = out;
+            char_type* const out_end      = out + capacity;
+            std::size_t      replacements = 0;
+
+            const auto result = [&](const conversion::status_e status) {
+                return conversion::conversion_result_t{ status, static_cast<std::size_t>(it - in), static_cast<std::size_t>(out_it - out), replacements };
+            };
+
+            while (it < end) {
+                if (load_unit<swap_input>(it) <= constants::one_byte_boundary) {
+                    // the kernel may write a whole vector past the last ASCII character, so it must fit in both strings
+                    const std::size_t max_size = std::min<std::size_t>(end - it, out_end - out_it);
+                    const std::size_t copied   = copy_ascii<tier, unit_type, char_type, swap_input>(it, max_size, out_it);
+                    it     += copied;
+                    out_it += copied;
+                    while (it < end && out_it < out_end && load_unit<swap_input>(it) <= constants::one_byte_boundary) {
+                        *out_it++ = static_cast<char_type>(load_unit<swap_input>(it++));
+                    }
+                    if (it < end && load_unit<swap_input>(it) <= constants::one_byte_boundary) {
+                        return result(conversion::status_e::output_too_small);
+                    }
+                    continue;
+                }
+
+                // get this character
+                const char16_t this_character = load_unit<swap_input>(it);
+                const char16_t next_character = it + 1 < end ? load_unit<swap_input>(it + 1) : 0;
+                char32_t code_point = this_character;
+                std::size_t units   = 1;
+                bool lone_surrogate = false;
+
+                // if can be part of double character
+                if (is_high_surrogate(this_character)) {
+                    // if there is no next character or it is not a part of the double character we take this as code point
+                    if (it + 1 == end || !is_low_surrogate(next_character)) {
+                        lone_surrogate = true;
+                    }
+                    else {
+                        // do decoding "double UTF-16" -> UTF-32:
+                        // https://en.wikipedia.org/wiki/UTF-16#Code_points_from_U+010000_to_U+10FFFF
+                        code_point = ((this_character - constants::high_surrogate_start) << 10) +
+                                     (next_character - constants::low_surrogate_start)           +
+                                     constants::supplementary_plane_offset;
+                        units      = 2;
+                    }
+                }
+                // low surrogate without high one before it
+                else if (is_low_surrogate(this_character)) {
+                    lone_surrogate = true;
+                }
+
+                bool replaced = false;
+                if (lone_surrogate) {
+                    if constexpr (policy == error_policy_e::strict) {
+                        return result(conversion::status_e::non_standard_encoding);
+                    }
+                    else if constexpr (policy == error_policy_e::skip) {
+                        it++;
+                        replacements++;
+                        continue;
+                    }
+                    else if constexpr (policy == error_policy_e::replace) {
+                        code_point = constants::replacement_character;
+                        replaced   = true;
+                    }
+                }
+
+                if (static_cast<std::size_t>(out_end - out_it) < sequence_length<char_type>(code_point)) {
+                    return result(conversion::status_e::output_too_small);
+                }
+                out_it        = encode(code_point, out_it);
+                it           += units;
+                replacements += replaced;
+            }
+
+            return result(conversion::status_e::success);
+        }
+
+        /**
+         * @internal
+         * @brief Loop converting UTF-32 string to either UTF-8 or UTF-16 string, inlined into the function of each tier.
+         * @tparam tier tier the loop is compiled for.
+         * @tparam char_type type of output code units (@c char8_t or @c char16_t).
+         * @tparam policy what to do with ill-formed input.
+         * @tparam swap_input should the bytes of input code units be reversed (the string is not in the native byte order).
+         * @tparam unit_type type of input code units, @c char32_t or unaligned_unit_t of it for byte streams.
+         * @details
+         * Runs of ASCII characters are handed over to the vectorized kernel, everything else is converted one code point at a time.
+         */
+        template <simd_tier_e tier, typename char_type, conversion::error_policy_e policy, bool swap_input, typename unit_type>
+        UTFUTILS_ALWAYS_INLINE conversion::conversion_result_t utf32_to_utf_loop(const unit_type* in, const std::size_t size, char_type* out, const std::size_t capacity) {
+            using conversion::error_policy_e;
+
+            char_type*       out_it       = out;
+            char_type* const out_end      = out + capacity;
+            std::size_t      replacements = 0;
+
+            std::size_t i = 0;
+            while (i < size) {
+                if (load_unit<swap_input>(in + i) <= constants::one_byte_boundary) {
+                    // the kernel may write a whole vector past the last ASCII character, so it must fit in both strings
+                    const std::size_t max_size = std::min<std::size_t>(size - i, out_end - out_it);
+                    const std::size_t copied   = copy_ascii<tier, unit_type, char_type, swap_input>(in + i, max_size, out_it);
+                    i      += copied;
+                    out_it += copied;
+                    while (i < size && out_it < out_end && load_unit<swap_input>(in + i) <= constants::one_byte_boundary) {
+                        *out_it++ = static_cast<char_type>(load_unit<swap_input>(in + i++));
+                    }
+                    if (i < size && load_unit<swap_input>(in + i) <= constants::one_byte_boundary) {
+                        return { conversion::status_e::output_too_small, i, static_cast<std::size_t>(out_it - out), replacements };
+                    }
+                    continue;
+                }
+
+                char32_t             this_code_point = load_unit<swap_input>(in + i);
+                conversion::status_e status          = conversion::status_e::success;
+
+                if (this_code_point > constants::four_byte_boundary) {
+                    status = conversion::status_e::undefined_error;
+                }
+                else if (policy != error_policy_e::pass_through && is_surrogate(this_code_point)) {
+                    status = conversion::status_e::non_standard_encoding;
+                }
+
+                bool replaced = false;
+                if (status < conversion::status_e::success) {
+                    if constexpr (policy == error_policy_e::strict || policy == error_policy_e::pass_through) {
+                        return { status, i, static_cast<std::size_t>(out_it - out), replacements };
+                    }
+                    else if constexpr (policy == error_policy_e::skip) {
+                        i++;
+                        replacements++;
+                        continue;
+                    }
+                    else {
+                        this_code_point = constants::replacement_character;
+                        replaced        = true;
+                    }
+                }
+                if (static_cast<std::size_t>(out_end - out_it) < sequence_length<char_type>(this_code_point)) {
+                    return { conversion::status_e::output_too_small, i, static_cast<std::size_t>(out_it - out), replacements };
+                }
+
+                out_it        = encode(this_code_point, out_it);
+                replacements += replaced;
+                i++;
+            }
+
+            return { conversion::status_e::success, size, static_cast<std::size_t>(out_it - out), replacements };
+        }
+
+        /**
+         * @internal
+         * @brief Signature of a conversion loop compiled for one tier.
+         * @tparam from_type type of input code units.
+         * @tparam to_type type of output code units.
+         */
+        template <typename from_type, typename to_type>
+        using conversion_kernel_t = conversion::conversion_result_t (*)(const from_type* in, std::size_t size, to_type* out, std::size_t capacity);
+
+        /**
+         * @internal
+         * @brief Picks the conversion loop for the encodings at compile time.
+         */
+        template <simd_tier_e tier, typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input>
+        UTFUTILS_ALWAYS_INLINE conversion::conversion_result_t conversion_loop(const from_type* in, const std::size_t size, to_type* out, const std::size_t capacity) {
+            if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+                return utf8_to_utf_loop<tier, to_type, policy>(in, size, out, capacity);
+            }
+            else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                return utf16_to_utf_loop<tier, to_type, policy, swap_input>(in, size, out, capacity);
+            }
+            else {
+                return utf32_to_utf_loop<tier, to_type, policy, swap_input>(in, size, out, capacity);
+            }
+        }
+        /**
+         * @internal
+         * @brief Conversion loop compiled for plain C++.
+         */
+        template <typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input>
+        conversion::conversion_result_t convert_scalar(const from_type* in, const std::size_t size, to_type* out, const std::size_t capacity) {
+            return conversion_loop<simd_tier_e::scalar, from_type, to_type, policy, swap_input>(in, size, out, capacity);
+        }
+#if defined(UTFUTILS_SSE2)
+        /**
+         * @internal
+         * @brief Conversion loop compiled for SSE2.
+         */
+        template <typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input>
+        conversion::conversion_result_t convert_sse2(const from_type* in, const std::size_t size, to_type* out, const std::size_t capacity) {
+            return conversion_loop<simd_tier_e::sse2, from_type, to_type, policy, swap_input>(in, size, out, capacity);
+        }
+#endif
+#if defined(UTFUTILS_X86)
+        /**
+         * @internal
+         * @brief Conversion loop compiled for SSE4.2.
+         */
+        template <typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input>
+        UTFUTILS_TARGET_SSE42 conversion::conversion_result_t convert_sse42(const from_type* in, const std::size_t size, to_type* out, const std::size_t capacity) {
+            return conversion_loop<simd_tier_e::sse42, from_type, to_type, policy, swap_input>(in, size, out, capacity);
+        }
+        /**
+         * @internal
+         * @brief Conversion loop compiled for AVX2.
+         */
+        template <typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input>
+        UTFUTILS_TARGET_AVX2 conversion::conversion_result_t convert_avx2(const from_type* in, const std::size_t size, to_type* out, const std::size_t capacity) {
+            return conversion_loop<simd_tier_e::avx2, from_type, to_type, policy, swap_input>(in, size, out, capacity);
+        }
+        /**
+         * @internal
+         * @brief Conversion loop compiled for AVX-512.
+         */
+        template <typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input>
+        UTFUTILS_TARGET_AVX512 conversion::conversion_result_t convert_avx512(const from_type* in, const std::size_t size, to_type* out, const std::size_t capacity) {
+            return conversion_loop<simd_tier_e::avx512, from_type, to_type, policy, swap_input>(in, size, out, capacity);
+        }
+#endif
+
+        /**
+         * @internal
+         * @brief Picks the best conversion loop not above the given tier.
+         * @tparam from_type type of input code units.
+         * @tparam to_type type of output code units.
+         * @tparam policy what to do with ill-formed input.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         */
+        template <typename from_type, typename to_type, conversion::error_policy_e policy, bool swap_input = false>
+        conversion_kernel_t<from_type, to_type> select_conversion_loop([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return convert_avx512<from_type, to_type, policy, swap_input>;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return convert_avx2<from_type, to_type, policy, swap_input>;
+            }
+            if (tier >= simd_tier_e::sse42) {
+                return convert_sse42<from_type, to_type, policy, swap_input>;
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if (tier >= simd_tier_e::sse2) {
+                return convert_sse2<from_type, to_type, policy, swap_input>;
+            }
+#endif
+            return convert_scalar<from_type, to_type, policy, swap_input>;
+        }
+
+        /**
+         * @internal
+         * @brief Converts UTF-8 string to either UTF-16 or UTF-32 string with the loop of the active tier.
+         * @tparam char_type type of output code units (@c char16_t or @c char32_t).
+         * @tparam policy what to do with ill-formed input.
+         */
+        template <typename char_type, conversion::error_policy_e policy>
+        conversion::conversion_result_t utf8_to_utf(const char8_t* in, const std::size_t size, char_type* out, const std::size_t capacity) {
+            static const dispatch_table_t<conversion_kernel_t<char8_t, char_type>> loop(select_conversion_loop<char8_t, char_type, policy>);
+            return loop(in, size, out, capacity);
+        }
+        /**
+         * @internal
+         * @brief Converts UTF-16 string to either UTF-8 or UTF-32 string with the loop of the active tier.
+         * @tparam char_type type of output code units (@c char8_t or @c char32_t).
+         * @tparam policy what to do with ill-formed input.
+         * @tparam swap_input should the bytes of input code units be reversed (the string is not in the native byte order).
+         * @tparam unit_type type of input code units, @c char16_t or unaligned_unit_t of it for byte streams.
+         */
+        template <typename char_type, conversion::error_policy_e policy, bool swap_input = false, typename unit_type>
+        conversion::conversion_result_t utf16_to_utf(const unit_type* in, const std::size_t size, char_type* out, const std::size_t capacity) {
+            static const dispatch_table_t<conversion_kernel_t<unit_type, char_type>> loop(select_conversion_loop<unit_type, char_type, policy, swap_input>);
+            return loop(in, size, out, capacity);
+        }
+        /**
+         * @internal
+         * @brief Converts UTF-32 string to either UTF-8 or UTF-16 string with the loop of the active tier.
+         * @tparam char_type type of output code units (@c char8_t or @c char16_t).
+         * @tparam policy what to do with ill-formed input.
+         * @tparam swap_input should the bytes of input code units be reversed (the string is not in the native byte order).
+         * @tparam unit_type type of input code units, @c char32_t or unaligned_unit_t of it for byte streams.
+         */
+        template <typename char_type, conversion::error_policy_e policy, bool swap_input = false, typename unit_type>
+        conversion::conversion_result_t utf32_to_utf(const unit_type* in, const std::size_t size, char_type* out, const std::size_t capacity) {
+            static const dispatch_table_t<conversion_kernel_t<unit_type, char_type>> loop(select_conversion_loop<unit_type, char_type, policy, swap_input>);
+            return loop(in, size, out, capacity);
+        }
+
+        /**
+         * @internal
+         * @brief Carries the error policy into a generic lambda as a type.
+         */
+        template <conversion::error_policy_e policy>
+        using policy_constant = std::integral_constant<conversion::error_policy_e, policy>;
+        /**
+         * @internal
+         * @brief Calls the kernel compiled for the policy @p comply_with_standard stands for.
+         * @details
+         * The flag is checked once per string, the conversion loop itself has no run-time policy checks.
+         */
+        template <typename kernel_type>
+        conversion::conversion_result_t with_policy(bool comply_with_standard, const kernel_type& kernel) {
+            if (comply_with_standard) {
+                return kernel(policy_constant<conversion::error_policy_e::strict>());
+            }
+            return kernel(policy_constant<conversion::error_policy_e::pass_through>());
+        }
+
+        /**
+         * @internal
+         * @brief Converts UTF-8 string, @p comply_with_standard selects #conversion::error_policy_e::strict or #conversion::error_policy_e::pass_through.
+         */
+        template <typename char_type>
+        conversion::conversion_result_t utf8_to_utf(const char8_t* in, const std::size_t size, char_type* out, const std::size_t capacity, bool comply_with_standard) {
+            return with_policy(comply_with_standard, [&](auto policy) {
+                return utf8_to_utf<char_type, decltype(policy)::value>(in, size, out, capacity);
+            });
+        }
+        /**
+         * @internal
+         * @brief Converts UTF-16 string, @p comply_with_standard selects #conversion::error_policy_e::strict or #conversion::error_policy_e::pass_through.
+         */
+        template <typename char_type, bool swap_input = false, typename unit_type>
+        conversion::conversion_result_t utf16_to_utf(const unit_type* in, const std::size_t size, char_type* out, const std::size_t capacity, bool comply_with_standard) {
+            return with_policy(comply_with_standard, [&](auto policy) {
+                return utf16_to_utf<char_type, decltype(policy)::value, swap_input>(in, size, out, capacity);
+            });
+        }
+        /**
+         * @internal
+         * @brief Converts UTF-32 string, @p comply_with_standard selects #conversion::error_policy_e::strict or #conversion::error_policy_e::pass_through.
+         */
+        template <typename char_type, bool swap_input = false, typename unit_type>
+        conversion::conversion_result_t utf32_to_utf(const unit_type* in, const std::size_t size, char_type* out, const std::size_t capacity, bool comply_with_standard) {
+            return with_policy(comply_with_standard, [&](auto policy) {
+                return utf32_to_utf<char_type, decltype(policy)::value, swap_input>(in, size, out, capacity);
+            });
+        }
+
+        /**
+         * @internal
+         * @brief Signature of a kernel which skips the longest prefix of a string that is known to be valid.
+         * @tparam char_type type of input code units.
+         * @details
+         * The kernel processes whole vectors only and stops at (or a few code units before) the first suspicious one, so the
+         * caller has to check the rest of the string with the scalar code.
+         */
+        template <typename char_type>
+        using validation_kernel_t = std::size_t (*)(const char_type* in, std::size_t size, bool comply_with_standard);
+
+        /**
+         * @internal
+         * @brief Finds the start of UTF-8 sequence which may be cut at the given position.
+         * @param in Pointer to the beginning of UTF-8 string.
+         * @param position Offset to start from.
+         * @return offset of the last non-continuation byte among 3 bytes before @p position, or @p position if there is none.
+         */
+        inline std::size_t utf8_sequence_start(const char8_t* in, const std::size_t position) {
+            for (std::size_t back = 1; back <= 3 && back <= position; back++) {
+                if (in[position - back] >> 6 != constants::trailing_byte_marker) {
+                    return position - back;
+                }
+            }
+            return position;
+        }
+
+        /**
+         * @internal
+         * @brief Checks UTF-8 string one sequence at a time.
+         * @param in Pointer to the beginning of UTF-8 string.
+         * @param size Size of the string.
+         * @param position Offset to start from. Must be at the beginning of a sequence.
+         * @param comply_with_standard should encoded surrogates be rejected.
+         */
+        inline validation_result_t validate_utf8_scalar(const char8_t* in, const std::size_t size, const std::size_t position, bool comply_with_standard) {
+            const char8_t* it  = in + position;
+            const char8_t* end = in + size;
+            while (it < end) {
+                const char8_t* sequence_start = it;
+                char32_t code_point = 0;
+                const conversion::status_e status = decode_utf8(it, end, code_point);
+                if (status < conversion::status_e::success) {
+                    return { status, static_cast<std::size_t>(sequence_start - in) };
+                }
+                if (comply_with_standard && is_surrogate(code_point)) {
+                    return { conversion::status_e::non_standard_encoding, static_cast<std::size_t>(sequence_start - in) };
+                }
+            }
+            return { conversion::status_e::success, size };
+        }
+
+        /**
+         * @internal
+         * @brief Scalar stand-in for the vectorized UTF-8 validation kernels.
+         */
+        inline std::size_t validate_utf8_none(const char8_t*, std::size_t, bool) {
+            return 0;
+        }
+
+#if defined(UTFUTILS_X86)
+        /**
+         * @internal
+         * @brief Lookup tables of the vectorized UTF-8 validation.
+         * @details
+         * Every pair of adjacent bytes is classified by 3 nibbles: high and low nibbles of the first byte and the high nibble of
+         * the second one. Each nibble selects a set of error flags it may be part of; the pair is malformed if all 3 sets have
+         * some flag in common. Continuation bytes which have to follow 3- and 4-byte leads are checked separately. See
+         * <a href="https://arxiv.org/abs/2010.03090">Validating UTF-8 In Less Than One Instruction Per Byte</a>.
+         */
+        namespace utf8_lookup {
+            constexpr uint8_t too_short      = 1 << 0; /**< @internal 11______ 0_______ or 11______ 11______ */
+            constexpr uint8_t too_long       = 1 << 1; /**< @internal 0_______ 10______ */
+            constexpr uint8_t overlong_3     = 1 << 2; /**< @internal 11100000 100_____ */
+            constexpr uint8_t too_large      = 1 << 3; /**< @internal 11110100 1001____ and greater */
+            constexpr uint8_t surrogate      = 1 << 4; /**< @internal 11101101 101_____ */
+            constexpr uint8_t overlong_2     = 1 << 5; /**< @internal 1100000_ 10______ */
+            constexpr uint8_t too_large_1000 = 1 << 6; /**< @internal 11110101 1000____ and greater */
+            constexpr uint8_t overlong_4     = 1 << 6; /**< @internal 11110000 1000____ */
+            constexpr uint8_t two_conts      = 1 << 7; /**< @internal 10______ 10______ */
+            constexpr uint8_t carry          = too_short | too_long | two_conts; /**< @internal flags not depending on low nibble of the first byte */
+
+            /**
+             * @internal
+             * @brief Flags selected by the high nibble of the first byte.
+             */
+            alignas(16) constexpr uint8_t byte_1_high[16] = {
+                // 0_______ ________ <ASCII in byte 1>
+                too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                // 10______ ________ <continuation in byte 1>
+                two_conts, two_conts, two_conts, two_conts,
+                // 1100____ ________ <two byte lead in byte 1>
+                too_short | overlong_2,
+                // 1101____ ________ <two byte lead in byte 1>
+                too_short,
+                // 1110____ ________ <three byte lead in byte 1>
+                too_short | overlong_3 | surrogate,
+                // 1111____ ________ <four+ byte lead in byte 1>
+                too_short | too_large | too_large_1000 | overlong_4
+            };
+            /**
+             * @internal
+             * @brief Flags selected by the low nibble of the first byte.
+             */
+            alignas(16) constexpr uint8_t byte_1_low[16] = {
+                // ____0000 ________
+                carry | overlong_3 | overlong_2 | overlong_4,
+                // ____0001 ________
+                carry | overlong_2,
+                // ____001_ ________
+                carry,
+                carry,
+                // ____0100 ________
+                carry | too_large,
+                // ____0101 ________
+                carry | too_large | too_large_1000,
+                // ____011_ ________
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                // ____1___ ________
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                // ____1101 ________
+                carry | too_large | too_large_1000 | surrogate,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000
+            };
+            /**
+             * @internal
+             * @brief Flags selected by the high nibble of the second byte.
+             */
+            alignas(16) constexpr uint8_t byte_2_high[16] = {
+                // ________ 0_______ <ASCII in byte 2>
+                too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                // ________ 1000____
+                too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+                // ________ 1001____
+                too_long | overlong_2 | two_conts | overlong_3 | too_large,
+                // ________ 101_____
+                too_long | overlong_2 | two_conts | surrogate  | too_large,
+                too_long | overlong_2 | two_conts | surrogate  | too_large,
+                // ________ 11______ <lead byte in byte 2>
+                too_short, too_short, too_short, too_short
+            };
+        } // namespace utf8_lookup
+
+        /**
+         * @internal
+         * @brief SSSE3 kernel validating UTF-8 16 bytes at a time.
+         */
+        UTFUTILS_TARGET_SSSE3 inline std::size_t validate_utf8_ssse3(const char8_t* in, const std::size_t size, bool comply_with_standard) {
+            const __m128i byte_1_high     = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_1_high));
+            const __m128i byte_1_low      = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_1_low));
+            const __m128i byte_2_high     = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_2_high));
+            const __m128i low_nibble_mask = _mm_set1_epi8(0x0F);
+            const __m128i flags_mask      = _mm_set1_epi8(static_cast<char>(comply_with_standard ? 0xFF : ~utf8_lookup::surrogate));
+            // sequence is incomplete if one of the last 3 bytes is a lead byte which needs more bytes than there are left
+            const __m128i incomplete_max  = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                          static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF));
+            const __m128i zero            = _mm_setzero_si128();
+
+            __m128i previous_input      = zero;
+            __m128i previous_incomplete = zero;
+
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                __m128i error;
+
+                if (_mm_movemask_epi8(input) == 0) {
+                    // ASCII block is only wrong if the previous block ended in the middle of a sequence
+                    error               = previous_incomplete;
+                    previous_incomplete = zero;
+                }
+                else {
+                    const __m128i previous_1  = _mm_alignr_epi8(input, previous_input, 15);
+                    const __m128i previous_2  = _mm_alignr_epi8(input, previous_input, 14);
+                    const __m128i previous_3  = _mm_alignr_epi8(input, previous_input, 13);
+
+                    const __m128i flags_1_high = _mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(previous_1, 4), low_nibble_mask));
+                    const __m128i flags_1_low  = _mm_shuffle_epi8(byte_1_low,  _mm_and_si128(previous_1, low_nibble_mask));
+                    const __m128i flags_2_high = _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble_mask));
+                    const __m128i flags        = _mm_and_si128(_mm_and_si128(flags_1_high, flags_1_low), _mm_and_si128(flags_2_high, flags_mask));
+
+                    // only bytes after 111_____ (2 bytes back) or 1111____ (3 bytes back) have the high bit set
+                    const __m128i third_byte  = _mm_subs_epu8(previous_2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+                    const __m128i fourth_byte = _mm_subs_epu8(previous_3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                    const __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(third_byte, fourth_byte), _mm_set1_epi8(static_cast<char>(0x80)));
+
+                    error               = _mm_xor_si128(must_be_continuation, flags);
+                    previous_incomplete = _mm_subs_epu8(input, incomplete_max);
+                }
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF) {
+                    break;
+                }
+                previous_input = input;
+            }
+            return utf8_sequence_start(in, i);
+        }
+
+        /**
+         * @internal
+         * @brief AVX2 kernel validating UTF-8 32 bytes at a time.
+         * @remark Same algorithm as validate_utf8_ssse3(), see it for details.
+         */
+        UTFUTILS_TARGET_AVX2 inline std::size_t validate_utf8_avx2(const char8_t* in, const std::size_t size, bool comply_with_standard) {
+            const __m256i byte_1_high     = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_1_high)));
+            const __m256i byte_1_low      = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_1_low)));
+            const __m256i byte_2_high     = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_2_high)));
+            const __m256i low_nibble_mask = _mm256_set1_epi8(0x0F);
+            const __m256i flags_mask      = _mm256_set1_epi8(static_cast<char>(comply_with_standard ? 0xFF : ~utf8_lookup::surrogate));
+            const __m256i incomplete_max  = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                             -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                             static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF));
+            const __m256i zero            = _mm256_setzero_si256();
+
+            __m256i previous_input      = zero;
+            __m256i previous_incomplete = zero;
+
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                __m256i error;
+
+                if (_mm256_movemask_epi8(input) == 0) {
+                    error               = previous_incomplete;
+                    previous_incomplete = zero;
+                }
+                else {
+                    // bytes preceding the input, crossing the 128-bit lanes boundary
+                    const __m256i shifted_input = _mm256_permute2x128_si256(previous_input, input, 0x21);
+                    const __m256i previous_1    = _mm256_alignr_epi8(input, shifted_input, 15);
+                    const __m256i previous_2    = _mm256_alignr_epi8(input, shifted_input, 14);
+                    const __m256i previous_3    = _mm256_alignr_epi8(input, shifted_input, 13);
+
+                    const __m256i flags_1_high = _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(previous_1, 4), low_nibble_mask));
+                    const __m256i flags_1_low  = _mm256_shuffle_epi8(byte_1_low,  _mm256_and_si256(previous_1, low_nibble_mask));
+                    const __m256i flags_2_high = _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble_mask));
+                    const __m256i flags        = _mm256_and_si256(_mm256_and_si256(flags_1_high, flags_1_low), _mm256_and_si256(flags_2_high, flags_mask));
+
+                    const __m256i third_byte  = _mm256_subs_epu8(previous_2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+                    const __m256i fourth_byte = _mm256_subs_epu8(previous_3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                    const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(third_byte, fourth_byte), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+                    error               = _mm256_xor_si256(must_be_continuation, flags);
+                    previous_incomplete = _mm256_subs_epu8(input, incomplete_max);
+                }
+
+                if (!_mm256_testz_si256(error, error)) {
+                    break;
+                }
+                previous_input = input;
+            }
+            return utf8_sequence_start(in, i);
+        }
+
+        /**
+         * @internal
+         * @brief AVX-512 kernel validating UTF-8 64 bytes at a time.
+         * @remark Same algorithm as validate_utf8_ssse3(), see it for details.
+         */
+        UTFUTILS_TARGET_AVX512 inline std::size_t validate_utf8_avx512(const char8_t* in, const std::size_t size, bool comply_with_standard) {
+            const __m512i byte_1_high     = broadcast_lane_avx512(_mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_1_high)));
+            const __m512i byte_1_low      = broadcast_lane_avx512(_mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_1_low)));
+            const __m512i byte_2_high     = broadcast_lane_avx512(_mm_load_si128(reinterpret_cast<const __m128i*>(utf8_lookup::byte_2_high)));
+            const __m512i low_nibble_mask = _mm512_set1_epi8(0x0F);
+            const __m512i flags_mask      = _mm512_set1_epi8(static_cast<char>(comply_with_standard ? 0xFF : ~utf8_lookup::surrogate));
+            const __m512i incomplete_max  = _mm512_inserti32x4(_mm512_set1_epi8(-1), _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                                                                  static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF)), 3);
+            // the last 128-bit lane of the previous input followed by the first 3 lanes of the current one
+            const __m512i shift_lanes     = _mm512_setr_epi64(6, 7, 8, 9, 10, 11, 12, 13);
+            const __m512i zero            = _mm512_setzero_si512();
+
+            __m512i previous_input      = zero;
+            __m512i previous_incomplete = zero;
+
+            std::size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                const __m512i input = _mm512_loadu_si512(in + i);
+                __m512i error;
+
+                if (_mm512_movepi8_mask(input) == 0) {
+                    error               = previous_incomplete;
+                    previous_incomplete = zero;
+                }
+                else {
+                    const __m512i shifted_input = _mm512_permutex2var_epi64(previous_input, shift_lanes, input);
+                    const __m512i previous_1    = _mm512_alignr_epi8(input, shifted_input, 15);
+                    const __m512i previous_2    = _mm512_alignr_epi8(input, shifted_input, 14);
+                    const __m512i previous_3    = _mm512_alignr_epi8(input, shifted_input, 13);
+
+                    const __m512i flags_1_high = _mm512_shuffle_epi8(byte_1_high, _mm512_and_si512(_mm512_srli_epi16(previous_1, 4), low_nibble_mask));
+                    const __m512i flags_1_low  = _mm512_shuffle_epi8(byte_1_low,  _mm512_and_si512(previous_1, low_nibble_mask));
+                    const __m512i flags_2_high = _mm512_shuffle_epi8(byte_2_high, _mm512_and_si512(_mm512_srli_epi16(input, 4), low_nibble_mask));
+                    const __m512i flags        = _mm512_and_si512(_mm512_and_si512(flags_1_high, flags_1_low), _mm512_and_si512(flags_2_high, flags_mask));
+
+                    const __m512i third_byte  = _mm512_subs_epu8(previous_2, _mm512_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+                    const __m512i fourth_byte = _mm512_subs_epu8(previous_3, _mm512_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                    const __m512i must_be_continuation = _mm512_and_si512(_mm512_or_si512(third_byte, fourth_byte), _mm512_set1_epi8(static_cast<char>(0x80)));
+
+                    error               = _mm512_xor_si512(must_be_continuation, flags);
+                    previous_incomplete = _mm512_subs_epu8(input, incomplete_max);
+                }
+
+                if (_mm512_test_epi8_mask(error, error) != 0) {
+                    break;
+                }
+                previous_input = input;
+            }
+            return utf8_sequence_start(in, i);
+        }
+
+        /**
+         * @internal
+         * @brief Lookup tables of the SSE4.1 UTF-8 decoder.
+         * @details
+         * The decoder looks up the sequences within the first 12 of 16 bytes by the mask of their last bytes (the bytes followed by
+         * a lead byte). The mask gives the number of bytes to decode and the byte shuffle moving each sequence into a lane of its
+         * own: six sequences of 1 or 2 bytes into 16-bit lanes, or else up to four sequences of 1 to 3 bytes into 32-bit lanes.
+         * The last byte of a sequence goes to the lowest byte of its lane, the lead byte to the highest one in use. Masks which
+         * start with a 4-byte sequence have no shuffle, the decoder handles that sequence on its own.
+         */
+        namespace utf8_decode {
+            constexpr uint8_t     no_shuffle           = 0xFF;
+            constexpr std::size_t narrow_shuffle_count = 64;                         /**< @internal each of 6 sequences takes 1 or 2 bytes */
+            constexpr std::size_t wide_shuffle_offsets[5] = { 0, 0, 3, 3 + 9, 3 + 9 + 27 }; /**< @internal by number of sequences, each takes 1 to 3 bytes */
+            constexpr std::size_t shuffle_count        = narrow_shuffle_count + 3 + 9 + 27 + 81;
+
+            struct tables_t {
+                uint8_t shuffle[4096]               = {}; /**< @internal shuffle by the mask of last bytes */
+                uint8_t consumed[4096]              = {}; /**< @internal bytes decoded by the mask of last bytes */
+                uint8_t shuffles[shuffle_count][16] = {};
+                uint8_t units[shuffle_count]        = {}; /**< @internal code points decoded by the shuffle */
+            };
+
+            constexpr tables_t make_tables() {
+                tables_t tables;
+                for (std::size_t end_mask = 0; end_mask < 4096; end_mask++) {
+                    std::size_t lengths[12] = {};
+                    std::size_t count       = 0;
+                    for (std::size_t i = 0, start = 0; i < 12; i++) {
+                        if (end_mask >> i & 1) {
+                            lengths[count++] = i + 1 - start;
+                            start            = i + 1;
+                        }
+                    }
+                    std::size_t narrow = 0;
+                    while (narrow < 6 && narrow < count && lengths[narrow] <= 2) {
+                        narrow++;
+                    }
+                    std::size_t wide = 0;
+                    while (wide < 4 && wide < count && lengths[wide] <= 3) {
+                        wide++;
+                    }
+                    if (narrow < 6 && wide == 0) {
+                        tables.shuffle[end_mask] = no_shuffle;
+                        continue;
+                    }
+
+                    const std::size_t sequences  = narrow == 6 ? 6 : wide;
+                    const std::size_t lane_size  = narrow == 6 ? 2 : 4;
+                    std::size_t       index      = narrow == 6 ? 0 : narrow_shuffle_count + wide_shuffle_offsets[wide];
+                    std::size_t       digit      = 1;
+                    std::size_t       start      = 0;
+                    uint8_t           shuffle[16] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+                    for (std::size_t k = 0; k < sequences; k++) {
+                        for (std::size_t byte = 0; byte < lengths[k]; byte++) {
+                            shuffle[lane_size * k + byte] = static_cast<uint8_t>(start + lengths[k] - 1 - byte);
+                        }
+                        index += (lengths[k] - 1) * digit;
+                        digit *= narrow == 6 ? 2 : 3;
+                        start += lengths[k];
+                    }
+
+                    tables.shuffle[end_mask]  = static_cast<uint8_t>(index);
+                    tables.consumed[end_mask] = static_cast<uint8_t>(start);
+                    tables.units[index]       = static_cast<uint8_t>(sequences);
+                    for (std::size_t byte = 0; byte < 16; byte++) {
+                        tables.shuffles[index][byte] = shuffle[byte];
+                    }
+                }
+                return tables;
+            }
+
+            inline constexpr tables_t tables = make_tables();
+        } // namespace utf8_decode
+
+        /**
+         * @internal
+         * @brief SSE4.1 kernel decoding well-formed UTF-8 into UTF-16 or UTF-32 string, up to 16 bytes at a time.
+         * @param size number of bytes known to be well-formed, ending on a sequence boundary.
+         * @param[out] written number of code units written.
+         * @return number of bytes decoded.
+         * @details
+         * A block of ASCII characters is widened as a whole, any other block goes through the tables in utf8_decode. Stops when
+         * less than 16 bytes are left or there is no room for 16 code units, the caller decodes the rest.
+         */
+        template <typename char_type>
+        UTFUTILS_TARGET_SSE42 std::size_t decode_utf8_sse42(const char8_t* in, const std::size_t size, char_type* out, const std::size_t capacity, std::size_t& written) {
+            const __m128i continuation_max = _mm_set1_epi8(static_cast<char>(0xBF));
+            const __m128i zero             = _mm_setzero_si128();
+
+            std::size_t i = 0;
+            std::size_t o = 0;
+            while (i + 16 <= size && o + 16 <= capacity) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                if (_mm_movemask_epi8(bytes) == 0) {
+                    if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o),     _mm_unpacklo_epi8(bytes, zero));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o + 8), _mm_unpackhi_epi8(bytes, zero));
+                    }
+                    else {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o),      _mm_cvtepu8_epi32(bytes));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o + 4),  _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o + 8),  _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o + 12), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12)));
+                    }
+                    i += 16;
+                    o += 16;
+                    continue;
+                }
+
+                // as signed numbers continuation bytes are the smallest ones
+                const uint32_t leads    = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(bytes, continuation_max)));
+                const uint32_t end_mask = leads >> 1 & 0xFFF;
+                const uint8_t  index    = utf8_decode::tables.shuffle[end_mask];
+                if (index == utf8_decode::no_shuffle) {
+                    // 11110www 10zzzzzz 10yyyyyy 10xxxxxx
+                    const char32_t code_point = static_cast<char32_t>(in[i] & 0x07) << 18 | static_cast<char32_t>(in[i + 1] & 0x3F) << 12 |
+                                                static_cast<char32_t>(in[i + 2] & 0x3F) << 6 | static_cast<char32_t>(in[i + 3] & 0x3F);
+                    o  = static_cast<std::size_t>(encode(code_point, out + o) - out);
+                    i += 4;
+                    continue;
+                }
+
+                const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf8_decode::tables.shuffles[index]));
+                const __m128i lanes   = _mm_shuffle_epi8(bytes, shuffle);
+                if (index < utf8_decode::narrow_shuffle_count) {
+                    // 00000000 0xxxxxxx or 110yyyyy 10xxxxxx
+                    const __m128i code_points = _mm_or_si128(_mm_and_si128(lanes, _mm_set1_epi16(0x7F)),
+                                                             _mm_and_si128(_mm_srli_epi16(lanes, 2), _mm_set1_epi16(0x07C0)));
+                    if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), code_points);
+                    }
+                    else {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o),     _mm_cvtepu16_epi32(code_points));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o + 4), _mm_cvtepu16_epi32(_mm_srli_si128(code_points, 8)));
+                    }
+                }
+                else {
+                    // 00000000 00000000 00000000 0xxxxxxx, 00000000 00000000 110yyyyy 10xxxxxx or 00000000 1110zzzz 10yyyyyy 10xxxxxx
+                    const __m128i code_points = _mm_or_si128(_mm_or_si128(_mm_and_si128(lanes, _mm_set1_epi32(0x7F)),
+                                                                          _mm_and_si128(_mm_srli_epi32(lanes, 2), _mm_set1_epi32(0x0FC0))),
+                                                             _mm_and_si128(_mm_srli_epi32(lanes, 4), _mm_set1_epi32(0xF000)));
+                    if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), _mm_packus_epi32(code_points, code_points));
+                    }
+                    else {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), code_points);
+                    }
+                }
+                i += utf8_decode::tables.consumed[end_mask];
+                o += utf8_decode::tables.units[index];
+            }
+            written = o;
+            return i;
+        }
+
+        /**
+         * @internal
+         * @brief AVX-512 kernel decoding well-formed UTF-8 into UTF-16 or UTF-32 string, 16 bytes at a time.
+         * @param size number of bytes known to be well-formed, ending on a sequence boundary.
+         * @param[out] written number of code units written.
+         * @return number of bytes decoded.
+         * @details
+         * Each of 16 bytes gets a 32-bit lane holding it and the 3 bytes after it, so every lane which holds a lead byte decodes
+         * its code point at once and the lanes of lead bytes are compressed together. A 4-byte sequence becomes a surrogate pair
+         * in UTF-16, the low surrogate takes the lane of the continuation byte right after the lead byte. Stops when less than
+         * 19 bytes are left or there is no room for 16 code units, the caller decodes the rest.
+         */
+        template <typename char_type>
+        UTFUTILS_TARGET_AVX512 std::size_t decode_utf8_avx512(const char8_t* in, const std::size_t size, char_type* out, const std::size_t capacity, std::size_t& written) {
+            const __mmask16 all        = 0xFFFF;
+            const __m512i   low_6_bits = _mm512_set1_epi32(0x3F);
+
+            std::size_t i = 0;
+            std::size_t o = 0;
+            // sequences starting within 16 bytes may take 3 bytes more
+            while (i + 19 <= size && o + 16 <= capacity) {
+                const __m512i byte_0 = _mm512_maskz_cvtepu8_epi32(all, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+                const __m512i byte_1 = _mm512_maskz_cvtepu8_epi32(all, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 1)));
+                const __m512i byte_2 = _mm512_maskz_cvtepu8_epi32(all, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 2)));
+                const __m512i byte_3 = _mm512_maskz_cvtepu8_epi32(all, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 3)));
+
+                const __mmask16 leads = _mm512_cmpneq_epi32_mask(_mm512_and_si512(byte_0, _mm512_set1_epi32(0xC0)), _mm512_set1_epi32(0x80));
+                const __mmask16 two   = _mm512_cmpge_epu32_mask(byte_0, _mm512_set1_epi32(0xC0));
+                const __mmask16 three = _mm512_cmpge_epu32_mask(byte_0, _mm512_set1_epi32(0xE0));
+                const __mmask16 four  = _mm512_cmpge_epu32_mask(byte_0, _mm512_set1_epi32(0xF0));
+                const __m512i   low_1 = _mm512_and_si512(byte_1, low_6_bits);
+                const __m512i   low_2 = _mm512_and_si512(byte_2, low_6_bits);
+
+                // 110yyyyy 10xxxxxx
+                __m512i code_points = _mm512_mask_mov_epi32(byte_0, two,
+                    _mm512_or_si512(_mm512_maskz_slli_epi32(all, _mm512_and_si512(byte_0, _mm512_set1_epi32(0x1F)), 6), low_1));
+                // 1110zzzz 10yyyyyy 10xxxxxx
+                code_points = _mm512_mask_mov_epi32(code_points, three,
+                    _mm512_or_si512(_mm512_or_si512(_mm512_maskz_slli_epi32(all, _mm512_and_si512(byte_0, _mm512_set1_epi32(0x0F)), 12),
+                                                    _mm512_maskz_slli_epi32(all, low_1, 6)), low_2));
+
+                __mmask16   keep     = leads;
+                std::size_t consumed = 16;
+                if constexpr (sizeof(char_type) == sizeof(char32_t)) {
+                    // 11110www 10zzzzzz 10yyyyyy 10xxxxxx
+                    code_points = _mm512_mask_mov_epi32(code_points, four,
+                        _mm512_or_si512(_mm512_or_si512(_mm512_maskz_slli_epi32(all, _mm512_and_si512(byte_0, _mm512_set1_epi32(0x07)), 18),
+                                                        _mm512_maskz_slli_epi32(all, low_1, 12)),
+                                        _mm512_or_si512(_mm512_maskz_slli_epi32(all, low_2, 6), _mm512_and_si512(byte_3, low_6_bits))));
+                }
+                else {
+                    // high surrogate: 110110 + (code point >> 10) - 0x40, low surrogate: 110111 + 10 lowest bits (of bytes 3 and 4,
+                    // which are bytes 2 and 3 of the lane right after the lead byte)
+                    const __m512i high = _mm512_add_epi32(_mm512_set1_epi32(0xD7C0),
+                        _mm512_or_si512(_mm512_or_si512(_mm512_maskz_slli_epi32(all, _mm512_and_si512(byte_0, _mm512_set1_epi32(0x07)), 8),
+                                                        _mm512_maskz_slli_epi32(all, low_1, 2)),
+                                        _mm512_maskz_srli_epi32(all, low_2, 4)));
+                    const __m512i low  = _mm512_or_si512(_mm512_set1_epi32(0xDC00),
+                        _mm512_or_si512(_mm512_maskz_slli_epi32(all, _mm512_and_si512(byte_1, _mm512_set1_epi32(0x0F)), 6), low_2));
+                    const __mmask16 pairs = static_cast<__mmask16>(four << 1);
+                    code_points = _mm512_mask_mov_epi32(code_points, four, high);
+                    code_points = _mm512_mask_mov_epi32(code_points, pairs, low);
+                    keep        = static_cast<__mmask16>(keep | pairs);
+                    // the low surrogate of a pair starting in the last lane has no lane, the pair is left for the next step
+                    if (four & 0x8000) {
+                        keep     = static_cast<__mmask16>(keep & 0x7FFF);
+                        consumed = 15;
+                    }
+                }
+
+                const __m512i compressed = _mm512_maskz_compress_epi32(keep, code_points);
+                if constexpr (sizeof(char_type) == sizeof(char32_t)) {
+                    _mm512_storeu_si512(out + o, compressed);
+                }
+                else {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + o), _mm512_maskz_cvtepi32_epi16(all, compressed));
+                }
+                // the last sequence may go on past the 16 bytes
+                while (consumed < 19 && in[i + consumed] >> 6 == constants::trailing_byte_marker) {
+                    consumed++;
+                }
+                i += consumed;
+                o += count_ones(keep);
+            }
+            written = o;
+            return i;
+        }
+
+        /**
+         * @internal
+         * @brief Number of bytes the UTF-8 conversion validates ahead with a single kernel call.
+         * @details
+         * Validating a window at a time rather than the whole string keeps the input in the cache for the conversion, and keeps
+         * the work wasted on a string which turns out to be ill-formed further on small.
+         */
+        constexpr std::size_t utf8_validation_window = 4096;
+
+        /**
+         * @internal
+         * @brief Decodes UTF-8 with the vectorized kernel of the tier as far as the string is known to be well-formed.
+         * @param[in] in pointer to the next byte, at the beginning of a sequence.
+         * @param[in] end pointer past the last byte of the string.
+         * @param[in,out] valid_end pointer past the bytes known to be well-formed, the next window is validated once @p in reaches it.
+         * @param[out] written number of code units written.
+         * @return number of bytes decoded, 0 if too few bytes are known to be well-formed or there is too little room for a vector.
+         * @details
+         * The AVX2 tier uses the SSE4.1 decoder as well: its lookup needs a byte shuffle within 16 bytes.
+         */
+        template <simd_tier_e tier, typename char_type, bool comply_with_standard>
+        UTFUTILS_ALWAYS_INLINE std::size_t decode_utf8_vectors(const char8_t* in, const char8_t* end, const char8_t*& valid_end, char_type* out, const std::size_t capacity, std::size_t& written) {
+            if (in >= valid_end) {
+                const std::size_t window = std::min<std::size_t>(end - in, utf8_validation_window);
+                if constexpr (tier >= simd_tier_e::avx512) {
+                    valid_end = in + validate_utf8_avx512(in, window, comply_with_standard);
+                }
+                else if constexpr (tier >= simd_tier_e::avx2) {
+                    valid_end = in + validate_utf8_avx2(in, window, comply_with_standard);
+                }
+                else {
+                    valid_end = in + validate_utf8_ssse3(in, window, comply_with_standard);
+                }
+            }
+            if constexpr (tier >= simd_tier_e::avx512) {
+                return decode_utf8_avx512(in, valid_end - in, out, capacity, written);
+            }
+            else {
+                return decode_utf8_sse42(in, valid_end - in, out, capacity, written);
+            }
+        }
+#endif
+
+        /**
+         * @internal
+         * @brief Scalar stand-in for the vectorized UTF-16 and UTF-32 validation kernels.
+         */
+        template <typename char_type>
+        std::size_t validate_utf_none(const char_type*, std::size_t, bool) {
+            return 0;
+        }
+
+#if defined(UTFUTILS_SSE2)
+        /**
+         * @internal
+         * @brief SSE2 kernel skipping UTF-16 code units until the first surrogate, 8 code units at a time.
+         */
+        inline std::size_t validate_utf16_sse2(const char16_t* in, const std::size_t size, bool) {
+            const __m128i surrogate_mask   = _mm_set1_epi16(static_cast<short>(0xF800));
+            const __m128i surrogate_marker = _mm_set1_epi16(static_cast<short>(constants::high_surrogate_start));
+
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                const __m128i units      = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(units, surrogate_mask), surrogate_marker);
+                const uint32_t mask      = static_cast<uint32_t>(_mm_movemask_epi8(surrogates));
+                if (mask != 0) {
+                    return i + count_trailing_zeros(mask) / sizeof(char16_t);
+                }
+            }
+            return i;
+        }
+        /**
+         * @internal
+         * @brief SSE2 kernel skipping valid UTF-32 code units, 4 code units at a time.
+         */
+        inline std::size_t validate_utf32_sse2(const char32_t* in, const std::size_t size, bool comply_with_standard) {
+            // there is no unsigned comparison in SSE2, so both sides are biased into signed range
+            const __m128i sign_bias        = _mm_set1_epi32(static_cast<int>(0x80000000u));
+            const __m128i biased_max       = _mm_set1_epi32(static_cast<int>(0x80000000u + constants::four_byte_boundary));
+            const __m128i surrogate_mask   = _mm_set1_epi32(static_cast<int>(0xFFFFF800u));
+            const __m128i surrogate_marker = _mm_set1_epi32(comply_with_standard ? constants::high_surrogate_start : -1);
+
+            std::size_t i = 0;
+            for (; i + 4 <= size; i += 4) {
+                const __m128i units      = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                const __m128i too_large  = _mm_cmpgt_epi32(_mm_xor_si128(units, sign_bias), biased_max);
+                const __m128i surrogates = _mm_cmpeq_epi32(_mm_and_si128(units, surrogate_mask), surrogate_marker);
+                const uint32_t mask      = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(too_large, surrogates)));
+                if (mask != 0) {
+                    return i + count_trailing_zeros(mask) / sizeof(char32_t);
+                }
+            }
+            return i;
+        }
+#endif
+
+#if defined(UTFUTILS_X86)
+        /**
+         * @internal
+         * @brief AVX2 kernel skipping UTF-16 code units until the first surrogate, 16 code units at a time.
+         */
+        UTFUTILS_TARGET_AVX2 inline std::size_t validate_utf16_avx2(const char16_t* in, const std::size_t size, bool) {
+            const __m256i surrogate_mask   = _mm256_set1_epi16(static_cast<short>(0xF800));
+            const __m256i surrogate_marker = _mm256_set1_epi16(static_cast<short>(constants::high_surrogate_start));
+
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                const __m256i units      = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                const __m256i surrogates = _mm256_cmpeq_epi16(_mm256_and_si256(units, surrogate_mask), surrogate_marker);
+                const uint32_t mask      = static_cast<uint32_t>(_mm256_movemask_epi8(surrogates));
+                if (mask != 0) {
+                    return i + count_trailing_zeros(mask) / sizeof(char16_t);
+                }
+            }
+            return i;
+        }
+        /**
+         * @internal
+         * @brief AVX2 kernel skipping valid UTF-32 code units, 8 code units at a time.
+         */
+        UTFUTILS_TARGET_AVX2 inline std::size_t validate_utf32_avx2(const char32_t* in, const std::size_t size, bool comply_with_standard) {
+            const __m256i max_code_point   = _mm256_set1_epi32(constants::four_byte_boundary);
+            const __m256i surrogate_mask   = _mm256_set1_epi32(static_cast<int>(0xFFFFF800u));
+            const __m256i surrogate_marker = _mm256_set1_epi32(comply_with_standard ? constants::high_surrogate_start : -1);
+
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                const __m256i units      = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                const __m256i in_range   = _mm256_cmpeq_epi32(_mm256_max_epu32(units, max_code_point), max_code_point);
+                const __m256i surrogates = _mm256_cmpeq_epi32(_mm256_and_si256(units, surrogate_mask), surrogate_marker);
+                const uint32_t mask      = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_andnot_si256(in_range, _mm256_set1_epi8(-1)))) |
+                                           static_cast<uint32_t>(_mm256_movemask_epi8(surrogates));
+                if (mask != 0) {
+                    return i + count_trailing_zeros(mask) / sizeof(char32_t);
+                }
+            }
+            return i;
+        }
+
+        /**
+         * @internal
+         * @brief AVX-512 kernel skipping UTF-16 code units until the first surrogate, 32 code units at a time.
+         */
+        UTFUTILS_TARGET_AVX512 inline std::size_t validate_utf16_avx512(const char16_t* in, const std::size_t size, bool) {
+            const __m512i surrogate_mask   = _mm512_set1_epi16(static_cast<short>(0xF800));
+            const __m512i surrogate_marker = _mm512_set1_epi16(static_cast<short>(constants::high_surrogate_start));
+
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                const __m512i units = _mm512_loadu_si512(in + i);
+                const uint32_t mask = _mm512_cmpeq_epi16_mask(_mm512_and_si512(units, surrogate_mask), surrogate_marker);
+                if (mask != 0) {
+                    return i + count_trailing_zeros(mask);
+                }
+            }
+            return i;
+        }
+        /**
+         * @internal
+         * @brief AVX-512 kernel skipping valid UTF-32 code units, 16 code units at a time.
+         */
+        UTFUTILS_TARGET_AVX512 inline std::size_t validate_utf32_avx512(const char32_t* in, const std::size_t size, bool comply_with_standard) {
+            const __m512i max_code_point   = _mm512_set1_epi32(constants::four_byte_boundary);
+            const __m512i surrogate_mask   = _mm512_set1_epi32(static_cast<int>(0xFFFFF800u));
+            const __m512i surrogate_marker = _mm512_set1_epi32(comply_with_standard ? constants::high_surrogate_start : -1);
+
+            std::size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                const __m512i units = _mm512_loadu_si512(in + i);
+                const uint32_t mask = static_cast<uint32_t>(_mm512_cmpgt_epu32_mask(units, max_code_point)) |
+                                      static_cast<uint32_t>(_mm512_cmpeq_epi32_mask(_mm512_and_si512(units, surrogate_mask), surrogate_marker));
+                if (mask != 0) {
+                    return i + count_trailing_zeros(mask);
+                }
+            }
+            return i;
+        }
+#endif
+
+        /**
+         * @internal
+         * @brief Picks the best UTF-8 validation kernel not above the given tier.
+         */
+        inline validation_kernel_t<char8_t> select_validate_utf8([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return validate_utf8_avx512;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return validate_utf8_avx2;
+            }
+            if (tier >= simd_tier_e::sse42) {
+                return validate_utf8_ssse3;
+            }
+#endif
+            return validate_utf8_none;
+        }
+        /**
+         * @internal
+         * @brief Picks the best UTF-16 validation kernel not above the given tier.
+         */
+        inline validation_kernel_t<char16_t> select_validate_utf16([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return validate_utf16_avx512;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return validate_utf16_avx2;
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if (tier >= simd_tier_e::sse2) {
+                return validate_utf16_sse2;
+            }
+#endif
+            return validate_utf_none<char16_t>;
+        }
+        /**
+         * @internal
+         * @brief Picks the best UTF-32 validation kernel not above the given tier.
+         */
+        inline validation_kernel_t<char32_t> select_validate_utf32([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return validate_utf32_avx512;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return validate_utf32_avx2;
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if (tier >= simd_tier_e::sse2) {
+                return validate_utf32_sse2;
+            }
+#endif
+            return validate_utf_none<char32_t>;
+        }
+
+        /**
+         * @internal
+         * @brief Signature of a kernel which counts code units a string converts into.
+         * @tparam char_type type of input code units.
+         */
+        template <typename char_type>
+        using count_kernel_t = std::size_t (*)(const char_type* in, std::size_t size);
+
+        /**
+         * @internal
+         * @brief Counts UTF-16 or UTF-32 code units UTF-8 string converts into.
+         * @tparam count_four_byte_leads should 4-byte sequences be counted twice (as surrogate pairs).
+         */
+        template <bool count_four_byte_leads>
+        std::size_t count_utf8_scalar(const char8_t* in, const std::size_t size) {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                count += in[i] >> 6 != constants::trailing_byte_marker;
+                if constexpr (count_four_byte_leads) {
+                    count += in[i] >= constants::quadruple_byte_marker << 3;
+                }
+            }
+            return count;
+        }
+        /**
+         * @internal
+         * @brief Counts UTF-8 or UTF-32 code units UTF-16 string converts into.
+         * @tparam count_utf8 should UTF-8 code units be counted instead of code points.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         * @tparam unit_type type of input code units, @c char16_t or unaligned_unit_t of it for byte streams.
+         * @details
+         * Every code unit is counted on its own: high surrogate followed by low one stands for a pair, anything else is converted
+         * separately. In UTF-8 the surrogate pair takes 4 bytes: 1 byte is counted for the high surrogate, 3 for the low one.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char16_t>
+        std::size_t count_utf16_scalar(const unit_type* in, const std::size_t size) {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                const char16_t unit        = load_unit<swap_input>(in + i);
+                const bool     paired_high = is_high_surrogate(unit) && i + 1 < size && is_low_surrogate(load_unit<swap_input>(in + i + 1));
+                if constexpr (count_utf8) {
+                    count += unit <= constants::one_byte_boundary ? 1 :
+                             unit <= constants::two_byte_boundary ? 2 :
+                             paired_high                           ? 1 : 3;
+                }
+                else {
+                    count += !paired_high;
+                }
+            }
+            return count;
+        }
+        /**
+         * @internal
+         * @brief Counts UTF-8 or UTF-16 code units UTF-32 string converts into.
+         * @tparam count_utf8 should UTF-8 code units be counted instead of UTF-16 ones.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         * @tparam unit_type type of input code units, @c char32_t or unaligned_unit_t of it for byte streams.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char32_t>
+        std::size_t count_utf32_scalar(const unit_type* in, const std::size_t size) {
+            std::size_t count = size;
+            for (std::size_t i = 0; i < size; i++) {
+                const char32_t unit = load_unit<swap_input>(in + i);
+                if constexpr (count_utf8) {
+                    count += (unit > constants::one_byte_boundary) + (unit > constants::two_byte_boundary);
+                }
+                count += unit > constants::three_byte_boundary;
+            }
+            return count;
+        }
+
+#if defined(UTFUTILS_SSE2)
+        /**
+         * @internal
+         * @brief Sums 4 32-bit integers.
+         */
+        inline int32_t horizontal_sum_epi32(const __m128i values) {
+            const __m128i pairs = _mm_add_epi32(values, _mm_shuffle_epi32(values, 0x4E));
+            return _mm_cvtsi128_si32(_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, 0xB1)));
+        }
+        /**
+         * @internal
+         * @brief SSE2 version of count_utf8_scalar() processing 16 bytes at a time.
+         */
+        template <bool count_four_byte_leads>
+        std::size_t count_utf8_sse2(const char8_t* in, const std::size_t size) {
+            const __m128i continuation_max = _mm_set1_epi8(static_cast<char>(0xBF));
+            const __m128i four_byte_lead   = _mm_set1_epi8(static_cast<char>(constants::quadruple_byte_marker << 3));
+            const __m128i zero             = _mm_setzero_si128();
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 16 <= size) {
+                // 8-bit counters hold up to 2 per block, so they are flushed every 127 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 16, 127) * 16;
+                __m128i counters = zero;
+                for (; i < blocks_end; i += 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    // as signed values continuation bytes are the smallest ones
+                    counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(bytes, continuation_max));
+                    if constexpr (count_four_byte_leads) {
+                        counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(_mm_max_epu8(bytes, four_byte_lead), bytes));
+                    }
+                }
+                const __m128i sums = _mm_sad_epu8(counters, zero);
+                count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+            }
+            return count + count_utf8_scalar<count_four_byte_leads>(in + i, size - i);
+        }
+        /**
+         * @internal
+         * @brief SSE2 version of count_utf16_scalar() processing 8 code units at a time.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char16_t>
+        std::size_t count_utf16_sse2(const unit_type* in, const std::size_t size) {
+            const __m128i one_byte_max     = _mm_set1_epi16(constants::one_byte_boundary);
+            const __m128i two_byte_max     = _mm_set1_epi16(constants::two_byte_boundary);
+            const __m128i surrogate_mask   = _mm_set1_epi16(static_cast<short>(0xFC00));
+            const __m128i high_surrogate   = _mm_set1_epi16(static_cast<short>(constants::high_surrogate_start));
+            const __m128i low_surrogate    = _mm_set1_epi16(static_cast<short>(constants::low_surrogate_start));
+            const __m128i ones             = _mm_set1_epi16(1);
+            const __m128i zero             = _mm_setzero_si128();
+            const std::size_t max_per_unit = count_utf8 ? 3 : 1;
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            // the code unit following the vector is needed to find surrogate pairs
+            while (i + 9 <= size) {
+                // counters are decremented by up to 4 per block, so they are flushed every 4096 blocks
+                const std::size_t blocks     = std::min<std::size_t>((size - i - 1) / 8, 4096);
+                const std::size_t blocks_end = i + blocks * 8;
+                __m128i counters = zero;
+                for (; i < blocks_end; i += 8) {
+                    const __m128i units       = load_units_sse2<swap_input>(in + i);
+                    const __m128i next_units  = load_units_sse2<swap_input>(in + i + 1);
+                    const __m128i paired_high = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(units,      surrogate_mask), high_surrogate),
+                                                              _mm_cmpeq_epi16(_mm_and_si128(next_units, surrogate_mask), low_surrogate));
+                    if constexpr (count_utf8) {
+                        const __m128i one_byte = _mm_cmpeq_epi16(_mm_subs_epu16(units, one_byte_max), zero);
+                        const __m128i two_byte = _mm_cmpeq_epi16(_mm_subs_epu16(units, two_byte_max), zero);
+                        counters = _mm_add_epi16(counters, _mm_add_epi16(_mm_add_epi16(one_byte, two_byte), _mm_add_epi16(paired_high, paired_high)));
+                    }
+                    else {
+                        counters = _mm_add_epi16(counters, paired_high);
+                    }
+                }
+                // counters hold the (negative) difference from the maximum size
+                count += max_per_unit * blocks * 8 + horizontal_sum_epi32(_mm_madd_epi16(counters, ones));
+            }
+            return count + count_utf16_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+        /**
+         * @internal
+         * @brief SSE2 version of count_utf32_scalar() processing 4 code units at a time.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char32_t>
+        std::size_t count_utf32_sse2(const unit_type* in, const std::size_t size) {
+            // there is no unsigned comparison in SSE2, so both sides are biased into signed range
+            const __m128i sign_bias      = _mm_set1_epi32(static_cast<int>(0x80000000u));
+            const __m128i one_byte_max   = _mm_set1_epi32(static_cast<int>(0x80000000u + constants::one_byte_boundary));
+            const __m128i two_byte_max   = _mm_set1_epi32(static_cast<int>(0x80000000u + constants::two_byte_boundary));
+            const __m128i three_byte_max = _mm_set1_epi32(static_cast<int>(0x80000000u + constants::three_byte_boundary));
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 4 <= size) {
+                // counters grow by up to 3 per block, so they are flushed every 2^24 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 4, std::size_t(1) << 24) * 4;
+                __m128i counters = _mm_setzero_si128();
+                for (; i < blocks_end; i += 4) {
+                    const __m128i units = _mm_xor_si128(load_units_sse2<swap_input>(in + i), sign_bias);
+                    if constexpr (count_utf8) {
+                        counters = _mm_sub_epi32(counters, _mm_cmpgt_epi32(units, one_byte_max));
+                        counters = _mm_sub_epi32(counters, _mm_cmpgt_epi32(units, two_byte_max));
+                    }
+                    counters = _mm_sub_epi32(counters, _mm_cmpgt_epi32(units, three_byte_max));
+                }
+                count += static_cast<uint32_t>(horizontal_sum_epi32(counters));
+            }
+            // every code unit takes at least 1 code unit
+            return i + count + count_utf32_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+#endif
+
+#if defined(UTFUTILS_X86)
+        /**
+         * @internal
+         * @brief SSE4.1 version of count_utf32_scalar() processing 4 code units at a time.
+         * @details
+         * The code unit is above the boundary if the unsigned maximum of the two is the code unit itself and not the boundary
+         * plus one, so no sign bias is needed as in count_utf32_sse2().
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char32_t>
+        UTFUTILS_TARGET_SSE42 std::size_t count_utf32_sse42(const unit_type* in, const std::size_t size) {
+            const __m128i one_byte_end   = _mm_set1_epi32(constants::one_byte_boundary + 1);
+            const __m128i two_byte_end   = _mm_set1_epi32(constants::two_byte_boundary + 1);
+            const __m128i three_byte_end = _mm_set1_epi32(constants::three_byte_boundary + 1);
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 4 <= size) {
+                // counters grow by up to 3 per block, so they are flushed every 2^24 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 4, std::size_t(1) << 24) * 4;
+                __m128i counters = _mm_setzero_si128();
+                for (; i < blocks_end; i += 4) {
+                    const __m128i units = load_units_ssse3<swap_input>(in + i);
+                    if constexpr (count_utf8) {
+                        counters = _mm_sub_epi32(counters, _mm_cmpeq_epi32(_mm_max_epu32(units, one_byte_end), units));
+                        counters = _mm_sub_epi32(counters, _mm_cmpeq_epi32(_mm_max_epu32(units, two_byte_end), units));
+                    }
+                    counters = _mm_sub_epi32(counters, _mm_cmpeq_epi32(_mm_max_epu32(units, three_byte_end), units));
+                }
+                count += static_cast<uint32_t>(horizontal_sum_epi32(counters));
+            }
+            // every code unit takes at least 1 code unit
+            return i + count + count_utf32_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+
+        /**
+         * @internal
+         * @brief AVX2 version of count_utf8_scalar() processing 32 bytes at a time.
+         */
+        template <bool count_four_byte_leads>
+        UTFUTILS_TARGET_AVX2 std::size_t count_utf8_avx2(const char8_t* in, const std::size_t size) {
+            const __m256i continuation_max = _mm256_set1_epi8(static_cast<char>(0xBF));
+            const __m256i four_byte_lead   = _mm256_set1_epi8(static_cast<char>(constants::quadruple_byte_marker << 3));
+            const __m256i zero             = _mm256_setzero_si256();
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 32 <= size) {
+                // 8-bit counters hold up to 2 per block, so they are flushed every 127 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 32, 127) * 32;
+                __m256i counters = zero;
+                for (; i < blocks_end; i += 32) {
+                    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                    counters = _mm256_sub_epi8(counters, _mm256_cmpgt_epi8(bytes, continuation_max));
+                    if constexpr (count_four_byte_leads) {
+                        counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, four_byte_lead), bytes));
+                    }
+                }
+                const __m256i sums      = _mm256_sad_epu8(counters, zero);
+                const __m128i half_sums = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+                count += _mm_cvtsi128_si32(half_sums) + _mm_extract_epi16(half_sums, 4);
+            }
+            return count + count_utf8_scalar<count_four_byte_leads>(in + i, size - i);
+        }
+        /**
+         * @internal
+         * @brief AVX2 version of count_utf16_scalar() processing 16 code units at a time.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char16_t>
+        UTFUTILS_TARGET_AVX2 std::size_t count_utf16_avx2(const unit_type* in, const std::size_t size) {
+            const __m256i one_byte_max     = _mm256_set1_epi16(constants::one_byte_boundary);
+            const __m256i two_byte_max     = _mm256_set1_epi16(constants::two_byte_boundary);
+            const __m256i surrogate_mask   = _mm256_set1_epi16(static_cast<short>(0xFC00));
+            const __m256i high_surrogate   = _mm256_set1_epi16(static_cast<short>(constants::high_surrogate_start));
+            const __m256i low_surrogate    = _mm256_set1_epi16(static_cast<short>(constants::low_surrogate_start));
+            const __m256i ones             = _mm256_set1_epi16(1);
+            const __m256i zero             = _mm256_setzero_si256();
+            const std::size_t max_per_unit = count_utf8 ? 3 : 1;
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 17 <= size) {
+                const std::size_t blocks     = std::min<std::size_t>((size - i - 1) / 16, 4096);
+                const std::size_t blocks_end = i + blocks * 16;
+                __m256i counters = zero;
+                for (; i < blocks_end; i += 16) {
+                    const __m256i units       = load_units_avx2<swap_input>(in + i);
+                    const __m256i next_units  = load_units_avx2<swap_input>(in + i + 1);
+                    const __m256i paired_high = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_and_si256(units,      surrogate_mask), high_surrogate),
+                                                                 _mm256_cmpeq_epi16(_mm256_and_si256(next_units, surrogate_mask), low_surrogate));
+                    if constexpr (count_utf8) {
+                        const __m256i one_byte = _mm256_cmpeq_epi16(_mm256_subs_epu16(units, one_byte_max), zero);
+                        const __m256i two_byte = _mm256_cmpeq_epi16(_mm256_subs_epu16(units, two_byte_max), zero);
+                        counters = _mm256_add_epi16(counters, _mm256_add_epi16(_mm256_add_epi16(one_byte, two_byte), _mm256_add_epi16(paired_high, paired_high)));
+                    }
+                    else {
+                        counters = _mm256_add_epi16(counters, paired_high);
+                    }
+                }
+                const __m256i sums = _mm256_madd_epi16(counters, ones);
+                count += max_per_unit * blocks * 16 + horizontal_sum_epi32(_mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1)));
+            }
+            return count + count_utf16_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+        /**
+         * @internal
+         * @brief AVX2 version of count_utf32_scalar() processing 8 code units at a time.
+         * @remark Same algorithm as count_utf32_sse42(), see it for details.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char32_t>
+        UTFUTILS_TARGET_AVX2 std::size_t count_utf32_avx2(const unit_type* in, const std::size_t size) {
+            const __m256i one_byte_end   = _mm256_set1_epi32(constants::one_byte_boundary + 1);
+            const __m256i two_byte_end   = _mm256_set1_epi32(constants::two_byte_boundary + 1);
+            const __m256i three_byte_end = _mm256_set1_epi32(constants::three_byte_boundary + 1);
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 8 <= size) {
+                // counters grow by up to 3 per block, so they are flushed every 2^24 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 8, std::size_t(1) << 24) * 8;
+                __m256i counters = _mm256_setzero_si256();
+                for (; i < blocks_end; i += 8) {
+                    const __m256i units = load_units_avx2<swap_input>(in + i);
+                    if constexpr (count_utf8) {
+                        counters = _mm256_sub_epi32(counters, _mm256_cmpeq_epi32(_mm256_max_epu32(units, one_byte_end), units));
+                        counters = _mm256_sub_epi32(counters, _mm256_cmpeq_epi32(_mm256_max_epu32(units, two_byte_end), units));
+                    }
+                    counters = _mm256_sub_epi32(counters, _mm256_cmpeq_epi32(_mm256_max_epu32(units, three_byte_end), units));
+                }
+                count += static_cast<uint32_t>(horizontal_sum_epi32(_mm_add_epi32(_mm256_castsi256_si128(counters), _mm256_extracti128_si256(counters, 1))));
+            }
+            // every code unit takes at least 1 code unit
+            return i + count + count_utf32_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+
+        /**
+         * @internal
+         * @brief AVX-512 version of count_utf8_scalar() processing 64 bytes at a time.
+         */
+        template <bool count_four_byte_leads>
+        UTFUTILS_TARGET_AVX512 std::size_t count_utf8_avx512(const char8_t* in, const std::size_t size) {
+            const __m512i continuation_max = _mm512_set1_epi8(static_cast<char>(0xBF));
+            const __m512i four_byte_lead   = _mm512_set1_epi8(static_cast<char>(constants::quadruple_byte_marker << 3));
+            const __m512i ones             = _mm512_set1_epi8(1);
+            const __m512i zero             = _mm512_setzero_si512();
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 64 <= size) {
+                // 8-bit counters hold up to 2 per block, so they are flushed every 127 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 64, 127) * 64;
+                __m512i counters = zero;
+                for (; i < blocks_end; i += 64) {
+                    const __m512i bytes = _mm512_loadu_si512(in + i);
+                    counters = _mm512_mask_add_epi8(counters, _mm512_cmpgt_epi8_mask(bytes, continuation_max), counters, ones);
+                    if constexpr (count_four_byte_leads) {
+                        counters = _mm512_mask_add_epi8(counters, _mm512_cmpge_epu8_mask(bytes, four_byte_lead), counters, ones);
+                    }
+                }
+                // the sums of absolute differences fit in the low halves of their 64-bit lanes
+                count += reduce_add_avx512(_mm512_sad_epu8(counters, zero));
+            }
+            return count + count_utf8_scalar<count_four_byte_leads>(in + i, size - i);
+        }
+        /**
+         * @internal
+         * @brief AVX-512 version of count_utf16_scalar() processing 32 code units at a time.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char16_t>
+        UTFUTILS_TARGET_AVX512 std::size_t count_utf16_avx512(const unit_type* in, const std::size_t size) {
+            const __m512i one_byte_max     = _mm512_set1_epi16(constants::one_byte_boundary);
+            const __m512i two_byte_max     = _mm512_set1_epi16(constants::two_byte_boundary);
+            const __m512i surrogate_mask   = _mm512_set1_epi16(static_cast<short>(0xFC00));
+            const __m512i high_surrogate   = _mm512_set1_epi16(static_cast<short>(constants::high_surrogate_start));
+            const __m512i low_surrogate    = _mm512_set1_epi16(static_cast<short>(constants::low_surrogate_start));
+            const __m512i ones             = _mm512_set1_epi16(1);
+            const __m512i twos             = _mm512_set1_epi16(2);
+            const std::size_t max_per_unit = count_utf8 ? 3 : 1;
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 33 <= size) {
+                // counters grow by up to 4 per block, so they are flushed every 4096 blocks
+                const std::size_t blocks     = std::min<std::size_t>((size - i - 1) / 32, 4096);
+                const std::size_t blocks_end = i + blocks * 32;
+                __m512i counters = _mm512_setzero_si512();
+                for (; i < blocks_end; i += 32) {
+                    const __m512i units         = load_units_avx512<swap_input>(in + i);
+                    const __m512i next_units    = load_units_avx512<swap_input>(in + i + 1);
+                    const __mmask32 paired_high = _mm512_cmpeq_epi16_mask(_mm512_and_si512(units,      surrogate_mask), high_surrogate) &
+                                                  _mm512_cmpeq_epi16_mask(_mm512_and_si512(next_units, surrogate_mask), low_surrogate);
+                    if constexpr (count_utf8) {
+                        counters = _mm512_mask_add_epi16(counters, _mm512_cmple_epu16_mask(units, one_byte_max), counters, ones);
+                        counters = _mm512_mask_add_epi16(counters, _mm512_cmple_epu16_mask(units, two_byte_max), counters, ones);
+                        counters = _mm512_mask_add_epi16(counters, paired_high, counters, twos);
+                    }
+                    else {
+                        counters = _mm512_mask_add_epi16(counters, paired_high, counters, ones);
+                    }
+                }
+                // counters hold the difference from the maximum size
+                count += max_per_unit * blocks * 32 - reduce_add_avx512(_mm512_madd_epi16(counters, ones));
+            }
+            return count + count_utf16_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+        /**
+         * @internal
+         * @brief AVX-512 version of count_utf32_scalar() processing 16 code units at a time.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char32_t>
+        UTFUTILS_TARGET_AVX512 std::size_t count_utf32_avx512(const unit_type* in, const std::size_t size) {
+            const __m512i one_byte_max   = _mm512_set1_epi32(constants::one_byte_boundary);
+            const __m512i two_byte_max   = _mm512_set1_epi32(constants::two_byte_boundary);
+            const __m512i three_byte_max = _mm512_set1_epi32(constants::three_byte_boundary);
+            const __m512i ones           = _mm512_set1_epi32(1);
+
+            std::size_t count = 0;
+            std::size_t i     = 0;
+            while (i + 16 <= size) {
+                // counters grow by up to 3 per block, so they are flushed every 2^24 blocks
+                const std::size_t blocks_end = i + std::min<std::size_t>((size - i) / 16, std::size_t(1) << 24) * 16;
+                __m512i counters = _mm512_setzero_si512();
+                for (; i < blocks_end; i += 16) {
+                    const __m512i units = load_units_avx512<swap_input>(in + i);
+                    if constexpr (count_utf8) {
+                        counters = _mm512_mask_add_epi32(counters, _mm512_cmpgt_epu32_mask(units, one_byte_max), counters, ones);
+                        counters = _mm512_mask_add_epi32(counters, _mm512_cmpgt_epu32_mask(units, two_byte_max), counters, ones);
+                    }
+                    counters = _mm512_mask_add_epi32(counters, _mm512_cmpgt_epu32_mask(units, three_byte_max), counters, ones);
+                }
+                count += reduce_add_avx512(counters);
+            }
+            // every code unit takes at least 1 code unit
+            return i + count + count_utf32_scalar<count_utf8, swap_input>(in + i, size - i);
+        }
+#endif
+
+        /**
+         * @internal
+         * @brief Picks the best kernel counting code units of UTF-8 string conversion result not above the given tier.
+         * @tparam count_four_byte_leads should 4-byte sequences be counted twice (as surrogate pairs).
+         */
+        template <bool count_four_byte_leads>
+        count_kernel_t<char8_t> select_count_utf8([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return count_utf8_avx512<count_four_byte_leads>;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return count_utf8_avx2<count_four_byte_leads>;
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if (tier >= simd_tier_e::sse2) {
+                return count_utf8_sse2<count_four_byte_leads>;
+            }
+#endif
+            return count_utf8_scalar<count_four_byte_leads>;
+        }
+        /**
+         * @internal
+         * @brief Picks the best kernel counting code units of UTF-16 string conversion result not above the given tier.
+         * @tparam count_utf8 should UTF-8 code units be counted instead of code points.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         * @tparam unit_type type of input code units, @c char16_t or unaligned_unit_t of it for byte streams.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char16_t>
+        count_kernel_t<unit_type> select_count_utf16([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return count_utf16_avx512<count_utf8, swap_input, unit_type>;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return count_utf16_avx2<count_utf8, swap_input, unit_type>;
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if (tier >= simd_tier_e::sse2) {
+                return count_utf16_sse2<count_utf8, swap_input, unit_type>;
+            }
+#endif
+            return count_utf16_scalar<count_utf8, swap_input, unit_type>;
+        }
+        /**
+         * @internal
+         * @brief Picks the best kernel counting code units of UTF-32 string conversion result not above the given tier.
+         * @tparam count_utf8 should UTF-8 code units be counted instead of UTF-16 ones.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         * @tparam unit_type type of input code units, @c char32_t or unaligned_unit_t of it for byte streams.
+         */
+        template <bool count_utf8, bool swap_input = false, typename unit_type = char32_t>
+        count_kernel_t<unit_type> select_count_utf32([[maybe_unused]] const simd_tier_e tier) {
+#if defined(UTFUTILS_X86)
+            if (tier >= simd_tier_e::avx512) {
+                return count_utf32_avx512<count_utf8, swap_input, unit_type>;
+            }
+            if (tier >= simd_tier_e::avx2) {
+                return count_utf32_avx2<count_utf8, swap_input, unit_type>;
+            }
+            if (tier >= simd_tier_e::sse42) {
+                return count_utf32_sse42<count_utf8, swap_input, unit_type>;
+            }
+#endif
+#if defined(UTFUTILS_SSE2)
+            if (tier >= simd_tier_e::sse2) {
+                return count_utf32_sse2<count_utf8, swap_input, unit_type>;
+            }
+#endif
+            return count_utf32_scalar<count_utf8, swap_input, unit_type>;
+        }
+
+        /**
+         * @internal
+         * @brief Number of code units the truncation counts with a single kernel call at first.
+         */
+        constexpr std::size_t truncation_block_size     = 4096;
+        /**
+         * @internal
+         * @brief Once blocks are halved down to this size, the truncation counts the rest one code unit at a time.
+         */
+        constexpr std::size_t truncation_min_block_size = 64;
+        /**
+         * @}
+         */
+
+        /**
+         * @addtogroup parallel Parallel Conversion
+         * Helpers splitting conversion between multiple threads.
+         * @{
+         */
+        /**
+         * @internal
+         * @brief Runs tasks on a group of threads, the calling thread included.
+         * @param[in] task_count number of tasks.
+         * @param[in] thread_count maximum number of threads.
+         * @param[in] task function taking the index of a task.
+         * @details
+         * Threads take the tasks one at a time, so tasks of uneven cost are balanced. If a thread can not be started,
+         * the already running ones (at least the calling one) do its share.
+         */
+        template <typename task_type>
+        void run_parallel(std::size_t task_count, std::size_t thread_count, const task_type& task) {
+            std::atomic<std::size_t> next_task{ 0 };
+            const auto worker = [&]() {
+                for (std::size_t i = next_task++; i < task_count; i = next_task++) {
+                    task(i);
+                }
+            };
+
+            std::vector<std::thread> threads;
+            const std::size_t extra_threads = std::min(thread_count, task_count) - 1;
+            threads.reserve(extra_threads);
+            for (std::size_t i = 0; i < extra_threads; i++) {
+                try {
+                    threads.emplace_back(worker);
+                } catch (const std::system_error&) {
+                    break;
+                }
+            }
+            worker();
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        }
+        /**
+         * @internal
+         * @brief Moves a split position back to the start of the code point it falls into.
+         * @param[in] in pointer to the string.
+         * @param[in] size length of the string.
+         * @param[in] position split position, greater than 0 and less than @p size.
+         */
+        template <typename char_type>
+        std::size_t code_point_boundary(const char_type* in, std::size_t size, std::size_t position) {
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                // a valid sequence has at most 3 continuation bytes, backing up further would stall on malformed input
+                const std::size_t split = position;
+                for (std::size_t i = 0; i < 3 && in[position] >> 6 == constants::trailing_byte_marker; i++) {
+                    position--;
+                }
+                // a longer run is malformed, it stays whole in the preceding chunk, so its lead byte fails as it does in a single thread
+                if (in[position] >> 6 == constants::trailing_byte_marker) {
+                    position = split;
+                    while (position < size && in[position] >> 6 == constants::trailing_byte_marker) {
+                        position++;
+                    }
+                }
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                if (is_high_surrogate(in[position - 1]) && is_low_surrogate(in[position])) {
+                    position--;
+                }
+            }
+            return position;
+        }
+        /**
+         * @internal
+         * @brief Converts a string using multiple threads.
+         * @details
+         * The input is cut into chunks at code point boundaries. The first pass counts the converted length of every chunk,
+         * the prefix sums of the lengths give each chunk its place in the output, and the second pass converts all chunks
+         * into one string allocated in between. The status is the one of the first failing chunk, which is the one the
+         * single-threaded conversion would stop at; chunks following a known failure are not converted.
+         */
+        template <typename from_type, typename to_type>
+        conversion::status_e parallel_convert(const std::basic_string_view<from_type>& from_sv, std::basic_string<to_type>& to_s, bool comply_with_standard, const conversion::parallel_options_t& options) {
+            const std::size_t size = from_sv.size();
+            const std::size_t thread_count = options.thread_count != 0 ? options.thread_count : std::thread::hardware_concurrency();
+
+            if (size < options.threshold || thread_count < 2) {
+                std::basic_string<to_type> result(length::converted_length<to_type>(from_sv), 0);
+                const conversion::conversion_result_t conversion_result = conversion::convert(from_sv, result.data(), result.size(), comply_with_standard);
+                if (conversion_result.status < conversion::status_e::success) {
+                    return conversion_result.status;
+                }
+
+                to_s = std::move(result);
+                return conversion::status_e::success;
+            }
+
+            // the grain must be longer than the longest sequence for every chunk to make progress
+            const std::size_t grain_size = std::max<std::size_t>(options.grain_size, 4);
+            std::vector<std::size_t> boundaries{ 0 };
+            for (std::size_t position = grain_size; position < size; position += grain_size) {
+                boundaries.push_back(code_point_boundary(from_sv.data(), size, position));
+            }
+            boundaries.push_back(size);
+            const std::size_t chunk_count = boundaries.size() - 1;
+            const auto chunk = [&](std::size_t i) {
+                return from_sv.substr(boundaries[i], boundaries[i + 1] - boundaries[i]);
+            };
+
+            std::vector<std::size_t> offsets(chunk_count + 1, 0);
+            run_parallel(chunk_count, thread_count, [&](std::size_t i) {
+                offsets[i + 1] = length::converted_length<to_type>(chunk(i));
+            });
+            for (std::size_t i = 0; i < chunk_count; i++) {
+                offsets[i + 1] += offsets[i];
+            }
+
+            std::basic_string<to_type> result(offsets[chunk_count], 0);
+            std::vector<conversion::status_e> statuses(chunk_count, conversion::status_e::success);
+            // chunks after a failing one can not change the status, so they are skipped once the failure is known
+            std::atomic<std::size_t> first_failure{ chunk_count };
+            run_parallel(chunk_count, thread_count, [&](std::size_t i) {
+                if (i > first_failure.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                statuses[i] = conversion::convert(chunk(i), result.data() + offsets[i], offsets[i + 1] - offsets[i], comply_with_standard).status;
+                if (statuses[i] < conversion::status_e::success) {
+                    std::size_t failure = first_failure.load(std::memory_order_relaxed);
+                    while (i < failure && !first_failure.compare_exchange_weak(failure, i, std::memory_order_relaxed)) {
+                    }
+                }
+            });
+            for (const conversion::status_e status : statuses) {
+                if (status < conversion::status_e::success) {
+                    return status;
+                }
+            }
+
+            to_s = std::move(result);
+            return conversion::status_e::success;
+        }
+        /**
+         * @}
+         */
+
+        /**
+         * @internal
+         * @brief Converts UTF-16 or UTF-32 byte stream which may be not in the native byte order.
+         * @tparam swap_input should the bytes of input code units be reversed.
+         */
+        template <typename from_type, typename to_type, bool swap_input>
+        conversion::status_e convert_units(const unaligned_unit_t<from_type>* in, std::size_t size, std::basic_string<to_type>& to_s, bool comply_with_standard) {
+            using unit_type = unaligned_unit_t<from_type>;
+            constexpr bool count_utf8 = sizeof(to_type) == sizeof(char8_t);
+            std::basic_string<to_type> result;
+            conversion::conversion_result_t conversion_result;
+
+            if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+                static const dispatch_table_t<count_kernel_t<unit_type>> count(select_count_utf16<count_utf8, swap_input, unit_type>);
+                result.resize(count(in, size));
+                conversion_result = utf16_to_utf<to_type, swap_input>(in, size, result.data(), result.size(), comply_with_standard);
+            }
+            else {
+                static const dispatch_table_t<count_kernel_t<unit_type>> count(select_count_utf32<count_utf8, swap_input, unit_type>);
+                result.resize(count(in, size));
+                conversion_result = utf32_to_utf<to_type, swap_input>(in, size, result.data(), result.size(), comply_with_standard);
+            }
+            if (conversion_result.status < conversion::status_e::success) {
+                return conversion_result.status;
+            }
+
+            to_s = std::move(result);
+            return conversion::status_e::success;
+        }
+        /**
+         * @internal
+         * @brief Converts UTF-16 or UTF-32 byte stream, picking the kernels by the byte order.
+         * @details
+         * The bytes are walked as unaligned_unit_t, so they need no alignment and are neither copied nor swapped beforehand.
+         */
+        template <typename from_type, typename to_type>
+        conversion::status_e convert_bytes(const std::string_view& from_bytes, conversion::byte_order_e byte_order, std::basic_string<to_type>& to_s, bool comply_with_standard) {
+            if (from_bytes.size() % sizeof(from_type) != 0) {
+                return conversion::status_e::undefined_error;
+            }
+
+            const unaligned_unit_t<from_type>* in   = reinterpret_cast<const unaligned_unit_t<from_type>*>(from_bytes.data());
+            const std::size_t                  size = from_bytes.size() / sizeof(from_type);
+            if (byte_order == conversion::native_byte_order) {
+                return convert_units<from_type, to_type, false>(in, size, to_s, comply_with_standard);
+            }
+            return convert_units<from_type, to_type, true>(in, size, to_s, comply_with_standard);
+        }
+    } // namespace kernels
+} // namespace utf
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard) {
+    std::basic_string<char16_t> result(length::utf16_from_utf8(utf8_sv), 0);
+    const conversion_result_t conversion_result = kernels::utf8_to_utf(utf8_sv.data(), utf8_sv.size(), result.data(), result.size(), comply_with_standard);
+    if (conversion_result.status < status_e::success) {
+        return conversion_result.status;
+    }
+
+    utf16_s = std::move(result);
+    return status_e::success;
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard) {
+    std::basic_string<char32_t> result(length::utf32_from_utf8(utf8_sv), 0);
+    const conversion_result_t conversion_result = kernels::utf8_to_utf(utf8_sv.data(), utf8_sv.size(), result.data(), result.size(), comply_with_standard);
+    if (conversion_result.status < status_e::success) {
+        return conversion_result.status;
+    }
+
+    utf32_s = std::move(result);
+    return status_e::success;
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard) {
+    std::basic_string<char8_t> result(length::utf8_from_utf16(utf16_sv), 0);
+    const conversion_result_t conversion_result = kernels::utf16_to_utf(utf16_sv.data(), utf16_sv.size(), result.data(), result.size(), comply_with_standard);
+    if (conversion_result.status < status_e::success) {
+        return conversion_result.status;
+    }
+
+    utf8_s = std::move(result);
+    return status_e::success;
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard) {
+    std::basic_string<char32_t> result(length::utf32_from_utf16(utf16_sv), 0);
+    const conversion_result_t conversion_result = kernels::utf16_to_utf(utf16_sv.data(), utf16_sv.size(), result.data(), result.size(), comply_with_standard);
+    if (conversion_result.status < status_e::success) {
+        return conversion_result.status;
+    }
+
+    utf32_s = std::move(result);
+    return status_e::success;
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard) {
+    std::basic_string<char8_t> result(length::utf8_from_utf32(utf32_sv), 0);
+    const conversion_result_t conversion_result = kernels::utf32_to_utf(utf32_sv.data(), utf32_sv.size(), result.data(), result.size(), comply_with_standard);
+    if (conversion_result.status < status_e::success) {
+        return conversion_result.status;
+    }
+
+    utf8_s = std::move(result);
+    return status_e::success;
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard) {
+    std::basic_string<char16_t> result(length::utf16_from_utf32(utf32_sv), 0);
+    const conversion_result_t conversion_result = kernels::utf32_to_utf(utf32_sv.data(), utf32_sv.size(), result.data(), result.size(), comply_with_standard);
+    if (conversion_result.status < status_e::success) {
+        return conversion_result.status;
+    }
+
+    utf16_s = std::move(result);
+    return status_e::success;
+}
+
+UTFUTILS_INLINE utf::conversion::conversion_result_t utf::conversion::utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, char16_t* utf16_buffer, std::size_t utf16_capacity, bool comply_with_standard) {
+    return kernels::utf8_to_utf(utf8_sv.data(), utf8_sv.size(), utf16_buffer, utf16_capacity, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::conversion_result_t utf::conversion::utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, char32_t* utf32_buffer, std::size_t utf32_capacity, bool comply_with_standard) {
+    return kernels::utf8_to_utf(utf8_sv.data(), utf8_sv.size(), utf32_buffer, utf32_capacity, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::conversion_result_t utf::conversion::utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, char8_t* utf8_buffer, std::size_t utf8_capacity, bool comply_with_standard) {
+    return kernels::utf16_to_utf(utf16_sv.data(), utf16_sv.size(), utf8_buffer, utf8_capacity, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::conversion_result_t utf::conversion::utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, char32_t* utf32_buffer, std::size_t utf32_capacity, bool comply_with_standard) {
+    return kernels::utf16_to_utf(utf16_sv.data(), utf16_sv.size(), utf32_buffer, utf32_capacity, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::conversion_result_t utf::conversion::utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, char8_t* utf8_buffer, std::size_t utf8_capacity, bool comply_with_standard) {
+    return kernels::utf32_to_utf(utf32_sv.data(), utf32_sv.size(), utf8_buffer, utf8_capacity, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::conversion_result_t utf::conversion::utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, char16_t* utf16_buffer, std::size_t utf16_capacity, bool comply_with_standard) {
+    return kernels::utf32_to_utf(utf32_sv.data(), utf32_sv.size(), utf16_buffer, utf16_capacity, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf8_to_utf16(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard, const parallel_options_t& options) {
+    return kernels::parallel_convert(utf8_sv, utf16_s, comply_with_standard, options);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf8_to_utf32(const std::basic_string_view<char8_t>& utf8_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard, const parallel_options_t& options) {
+    return kernels::parallel_convert(utf8_sv, utf32_s, comply_with_standard, options);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf16_to_utf8(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard, const parallel_options_t& options) {
+    return kernels::parallel_convert(utf16_sv, utf8_s, comply_with_standard, options);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf16_to_utf32(const std::basic_string_view<char16_t>& utf16_sv, std::basic_string<char32_t>& utf32_s, bool comply_with_standard, const parallel_options_t& options) {
+    return kernels::parallel_convert(utf16_sv, utf32_s, comply_with_standard, options);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf32_to_utf8(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char8_t>& utf8_s, bool comply_with_standard, const parallel_options_t& options) {
+    return kernels::parallel_convert(utf32_sv, utf8_s, comply_with_standard, options);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf32_to_utf16(const std::basic_string_view<char32_t>& utf32_sv, std::basic_string<char16_t>& utf16_s, bool comply_with_standard, const parallel_options_t& options) {
+    return kernels::parallel_convert(utf32_sv, utf16_s, comply_with_standard, options);
+}
+
+template <utf::conversion::error_policy_e policy, typename from_type, typename to_type>
+utf::conversion::conversion_result_t utf::conversion::convert(const std::basic_string_view<from_type>& from_sv, to_type* to_buffer, std::size_t to_capacity) {
+    static_assert(sizeof(from_type) != sizeof(to_type), "the string is already in the requested encoding");
+
+    if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+        return kernels::utf8_to_utf<to_type, policy>(from_sv.data(), from_sv.size(), to_buffer, to_capacity);
+    }
+    else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+        return kernels::utf16_to_utf<to_type, policy>(from_sv.data(), from_sv.size(), to_buffer, to_capacity);
+    }
+    else {
+        return kernels::utf32_to_utf<to_type, policy>(from_sv.data(), from_sv.size(), to_buffer, to_capacity);
+    }
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf16_to_utf8(const std::string_view& utf16_bytes, byte_order_e byte_order, std::basic_string<char8_t>& utf8_s, bool comply_with_standard) {
+    return kernels::convert_bytes<char16_t>(utf16_bytes, byte_order, utf8_s, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf16_to_utf32(const std::string_view& utf16_bytes, byte_order_e byte_order, std::basic_string<char32_t>& utf32_s, bool comply_with_standard) {
+    return kernels::convert_bytes<char16_t>(utf16_bytes, byte_order, utf32_s, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf32_to_utf8(const std::string_view& utf32_bytes, byte_order_e byte_order, std::basic_string<char8_t>& utf8_s, bool comply_with_standard) {
+    return kernels::convert_bytes<char32_t>(utf32_bytes, byte_order, utf8_s, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::conversion::status_e utf::conversion::utf32_to_utf16(const std::string_view& utf32_bytes, byte_order_e byte_order, std::basic_string<char16_t>& utf16_s, bool comply_with_standard) {
+    return kernels::convert_bytes<char32_t>(utf32_bytes, byte_order, utf16_s, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::simd_tier_e utf::supported_simd_tier() {
+    static const simd_tier_e tier = kernels::detect_simd_tier();
+    return tier;
+}
+
+UTFUTILS_INLINE utf::simd_tier_e utf::active_simd_tier() {
+    return kernels::simd_tier_state().load();
+}
+
+UTFUTILS_INLINE utf::simd_tier_e utf::set_simd_tier(simd_tier_e tier) {
+    tier = std::min(tier, supported_simd_tier());
+    kernels::simd_tier_state().store(tier);
+    return tier;
+}
+
+UTFUTILS_INLINE utf::validation_result_t utf::validate_utf8(const std::basic_string_view<char8_t>& utf8_sv, bool comply_with_standard) {
+    static const kernels::dispatch_table_t<kernels::validation_kernel_t<char8_t>> kernel(kernels::select_validate_utf8);
+
+    // the kernel stops right before the first malformed sequence it has found, the scalar code pinpoints it
+    const std::size_t valid_prefix = kernel(utf8_sv.data(), utf8_sv.size(), comply_with_standard);
+    return kernels::validate_utf8_scalar(utf8_sv.data(), utf8_sv.size(), valid_prefix, comply_with_standard);
+}
+
+UTFUTILS_INLINE utf::validation_result_t utf::validate_utf16(const std::basic_string_view<char16_t>& utf16_sv, bool comply_with_standard) {
+    static const kernels::dispatch_table_t<kernels::validation_kernel_t<char16_t>> kernel(kernels::select_validate_utf16);
+
+    // any sequence of UTF-16 code units can be converted if we do not care about unpaired surrogates
+    if (!comply_with_standard) {
+        return { conversion::status_e::success, utf16_sv.size() };
+    }
+
+    const char16_t* in   = utf16_sv.data();
+    const std::size_t size = utf16_sv.size();
+
+    std::size_t i = 0;
+    while (i < size) {
+        // skip everything up to the next surrogate
+        i += kernel(in + i, size - i, comply_with_standard);
+        if (i == size) {
+            break;
+        }
+        if (is_high_surrogate(in[i]) && i + 1 < size && is_low_surrogate(in[i + 1])) {
+            i += 2;
+            continue;
+        }
+        if (is_surrogate(in[i])) {
+            return { conversion::status_e::non_standard_encoding, i };
+        }
+        i++;
+    }
+    return { conversion::status_e::success, size };
+}
+
+UTFUTILS_INLINE utf::validation_result_t utf::validate_utf32(const std::basic_string_view<char32_t>& utf32_sv, bool comply_with_standard) {
+    static const kernels::dispatch_table_t<kernels::validation_kernel_t<char32_t>> kernel(kernels::select_validate_utf32);
+
+    const char32_t* in   = utf32_sv.data();
+    const std::size_t size = utf32_sv.size();
+
+    for (std::size_t i = kernel(in, size, comply_with_standard); i < size; i++) {
+        if (in[i] > constants::four_byte_boundary) {
+            return { conversion::status_e::undefined_error, i };
+        }
+        if (comply_with_standard && is_surrogate(in[i])) {
+            return { conversion::status_e::non_standard_encoding, i };
+        }
+    }
+    return { conversion::status_e::success, size };
+}
+UTFUTILS_INLINE std::size_t utf::length::utf16_from_utf8(const std::basic_string_view<char8_t>& utf8_sv) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char8_t>> kernel(kernels::select_count_utf8<true>);
+    return kernel(utf8_sv.data(), utf8_sv.size());
+}
+
+UTFUTILS_INLINE std::size_t utf::length::utf32_from_utf8(const std::basic_string_view<char8_t>& utf8_sv) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char8_t>> kernel(kernels::select_count_utf8<false>);
+    return kernel(utf8_sv.data(), utf8_sv.size());
+}
+
+UTFUTILS_INLINE std::size_t utf::length::utf8_from_utf16(const std::basic_string_view<char16_t>& utf16_sv) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char16_t>> kernel(kernels::select_count_utf16<true>);
+    return kernel(utf16_sv.data(), utf16_sv.size());
+}
+
+UTFUTILS_INLINE std::size_t utf::length::utf32_from_utf16(const std::basic_string_view<char16_t>& utf16_sv) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char16_t>> kernel(kernels::select_count_utf16<false>);
+    return kernel(utf16_sv.data(), utf16_sv.size());
+}
+
+UTFUTILS_INLINE std::size_t utf::length::utf8_from_utf32(const std::basic_string_view<char32_t>& utf32_sv) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char32_t>> kernel(kernels::select_count_utf32<true>);
+    return kernel(utf32_sv.data(), utf32_sv.size());
+}
+
+UTFUTILS_INLINE std::size_t utf::length::utf16_from_utf32(const std::basic_string_view<char32_t>& utf32_sv) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char32_t>> kernel(kernels::select_count_utf32<false>);
+    return kernel(utf32_sv.data(), utf32_sv.size());
+}
+
+UTFUTILS_INLINE std::size_t utf::count_code_points(const std::basic_string_view<char8_t>& utf8_sv) {
+    return length::utf32_from_utf8(utf8_sv);
+}
+
+UTFUTILS_INLINE std::size_t utf::count_code_points(const std::basic_string_view<char16_t>& utf16_sv) {
+    return length::utf32_from_utf16(utf16_sv);
+}
+
+UTFUTILS_INLINE std::size_t utf::count_code_points(const std::basic_string_view<char32_t>& utf32_sv) {
+    return utf32_sv.size();
+}
+
+UTFUTILS_INLINE std::size_t utf::truncate_to_code_points(const std::basic_string_view<char8_t>& utf8_sv, std::size_t max_code_points) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char8_t>> kernel(kernels::select_count_utf8<false>);
+
+    const char8_t*    in   = utf8_sv.data();
+    const std::size_t size = utf8_sv.size();
+
+    // every code point takes at least a byte
+    if (size <= max_code_points) {
+        return size;
+    }
+
+    // skip whole blocks while they fit, halving the block once it does not
+    std::size_t i = 0;
+    for (std::size_t block = kernels::truncation_block_size; block >= kernels::truncation_min_block_size; block /= 2) {
+        while (size - i >= block) {
+            const std::size_t count = kernel(in + i, block);
+            if (count > max_code_points) {
+                break;
+            }
+            max_code_points -= count;
+            i += block;
+        }
+    }
+
+    // cut right before the start of the first code point which does not fit
+    for (; i < size; i++) {
+        if (in[i] >> 6 == constants::trailing_byte_marker) {
+            continue;
+        }
+        if (max_code_points == 0) {
+            return i;
+        }
+        max_code_points--;
+    }
+    return size;
+}
+
+UTFUTILS_INLINE std::size_t utf::truncate_to_code_points(const std::basic_string_view<char16_t>& utf16_sv, std::size_t max_code_points) {
+    static const kernels::dispatch_table_t<kernels::count_kernel_t<char16_t>> kernel(kernels::select_count_utf16<false>);
+
+    const char16_t*   in   = utf16_sv.data();
+    const std::size_t size = utf16_sv.size();
+
+    if (size <= max_code_points) {
+        return size;
+    }
+
+    std::size_t i = 0;
+    for (std::size_t block = kernels::truncation_block_size; block >= kernels::truncation_min_block_size; block /= 2) {
+        while (size - i >= block) {
+            // do not split the surrogate pair between blocks, the kernel would count it twice
+            const std::size_t units = block - is_high_surrogate(in[i + block - 1]);
+            const std::size_t count = kernel(in + i, units);
+            if (count > max_code_points) {
+                break;
+            }
+            max_code_points -= count;
+            i += units;
+        }
+    }
+
+    for (; i < size; i++) {
+        if (i > 0 && is_low_surrogate(in[i]) && is_high_surrogate(in[i - 1])) {
+            continue;
+        }
+        if (max_code_points == 0) {
+            return i;
+        }
+        max_code_points--;
+    }
+    return size;
+}
+
+UTFUTILS_INLINE std::size_t utf::truncate_to_code_points(const std::basic_string_view<char32_t>& utf32_sv, std::size_t max_code_points) {
+    return std::min(utf32_sv.size(), max_code_points);
+}
+
+UTFUTILS_INLINE std::size_t utf::truncate_to_bytes(const std::basic_string_view<char8_t>& utf8_sv, std::size_t max_bytes) {
+    if (utf8_sv.size() <= max_bytes) {
+        return utf8_sv.size();
+    }
+
+    // step back to the lead byte of the sequence the cut falls into
+    std::size_t cut = max_bytes;
+    while (cut > 0 && max_bytes - cut < 3 && utf8_sv[cut] >> 6 == constants::trailing_byte_marker) {
+        cut--;
+    }
+    // too many continuation bytes in a row, the string is malformed here anyway
+    return utf8_sv[cut] >> 6 == constants::trailing_byte_marker ? max_bytes : cut;
+}
+
+UTFUTILS_INLINE std::size_t utf::truncate_to_bytes(const std::basic_string_view<char16_t>& utf16_sv, std::size_t max_bytes) {
+    const std::size_t max_units = max_bytes / sizeof(char16_t);
+    if (utf16_sv.size() <= max_units) {
+        return utf16_sv.size();
+    }
+
+    const bool splits_pair = max_units > 0 && is_low_surrogate(utf16_sv[max_units]) && is_high_surrogate(utf16_sv[max_units - 1]);
+    return max_units - splits_pair;
+}
+
+UTFUTILS_INLINE std::size_t utf::truncate_to_bytes(const std::basic_string_view<char32_t>& utf32_sv, std::size_t max_bytes) {
+    return std::min(utf32_sv.size(), max_bytes / sizeof(char32_t));
+}
+
+#if !defined(UTFUTILS_HEADER_ONLY)
+template class utf::stream_converter<char8_t, char16_t>;
+template class utf::stream_converter<char8_t, char32_t>;
+template class utf::stream_converter<char16_t, char8_t>;
+template class utf::stream_converter<char16_t, char32_t>;
+template class utf::stream_converter<char32_t, char8_t>;
+template class utf::stream_converter<char32_t, char16_t>;
+
+#   define UTFUTILS_INSTANTIATE_CONVERT(policy)                                                                                                  \
+        template utf::conversion::conversion_result_t utf::conversion::convert<policy>(const std::basic_string_view<char8_t>&, char16_t*, std::size_t);  \
+        template utf::conversion::conversion_result_t utf::conversion::convert<policy>(const std::basic_string_view<char8_t>&, char32_t*, std::size_t);  \
+        template utf::conversion::conversion_result_t utf::conversion::convert<policy>(const std::basic_string_view<char16_t>&, char8_t*, std::size_t);  \
+        template utf::conversion::conversion_result_t utf::conversion::convert<policy>(const std::basic_string_view<char16_t>&, char32_t*, std::size_t); \
+        template utf::conversion::conversion_result_t utf::conversion::convert<policy>(const std::basic_string_view<char32_t>&, char8_t*, std::size_t);  \
+        template utf::conversion::conversion_result_t utf::conversion::convert<policy>(const std::basic_string_view<char32_t>&, char16_t*, std::size_t);
+UTFUTILS_INSTANTIATE_CONVERT(utf::conversion::error_policy_e::strict)
+UTFUTILS_INSTANTIATE_CONVERT(utf::conversion::error_policy_e::replace)
+UTFUTILS_INSTANTIATE_CONVERT(utf::conversion::error_policy_e::skip)
+UTFUTILS_INSTANTIATE_CONVERT(utf::conversion::error_policy_e::pass_through)
+#   undef UTFUTILS_INSTANTIATE_CONVERT
+#endif
+
+#endif // !defined(UTFUTILS_IMPL_H)
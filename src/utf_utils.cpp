@@ -0,0 +1,2 @@
+// The compiled copy of the library, see utf_utils_impl.hpp.
+#include <utf-utils/utf_utils_impl.hpp>
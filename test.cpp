@@ -1,6 +1,6 @@
-#include "include/utf-utils/utf_utils.hpp"
+#include <utf-utils/utf_utils.hpp>
 
 int main()
 {
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,85 @@
+// C++20 consumer: calls every kind of UTF-8 function of the compiled library with the built-in char8_t, so a library whose
+// char8_t is not the one of the calling code fails to link (or, with UTFUTILS_LIBRARY_CHAR8_T, to compile). The compile-time
+// literal conversion and the ranges support of the views are checked with static_assert.
+//     utf-utils-cxx20-consumer
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <cstdio>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+static_assert(!std::is_same_v<char8_t, unsigned char>, "built for C++20, char8_t must be the built-in type");
+
+// literals converted at compile time, with each entry point: multi-byte, supplementary-plane and a lenient lone surrogate
+static_assert(utf::literals::convert<char16_t, utf::literals::converted_length<char16_t>(u8"ключ")>(u8"ключ").view() == u"ключ", "literals::convert");
+static_assert(utf::literals::convert<char8_t, utf::literals::converted_length<char8_t>(U"🔑")>(U"🔑").view() == u8"🔑", "literals::convert");
+static_assert(utf::literals::convert<char8_t, utf::literals::converted_length<char8_t>(u"a\xD800")>(u"a\xD800").view() == u8"a\xED\xA0\x80", "literals::convert");
+static_assert(UTFUTILS_LITERAL(char32_t, u8"ключ").view() == U"ключ", "UTFUTILS_LITERAL");
+static_assert(UTFUTILS_LITERAL(char16_t, u8"🔑").view() == u"\xD83D\xDD11", "UTFUTILS_LITERAL");
+static_assert(UTFUTILS_LITERAL(char32_t, u"a\xD800").view() == U"a\xD800", "UTFUTILS_LITERAL");
+static_assert(utf::literal<char8_t, u"ключ">.view() == u8"ключ", "utf::literal");
+static_assert(utf::literal<char32_t, u"a🔑">.view() == U"a\x1F511", "utf::literal");
+static_assert(utf::literal<char16_t, U"a\xDC00">.view() == u"a\xDC00", "utf::literal");
+
+// the views do not own the string, so they are views and their iterators outlive them
+static_assert(std::ranges::bidirectional_range<utf::code_point_view<char8_t>>, "code_point_view is bidirectional");
+static_assert(std::ranges::view<utf::code_point_view<char16_t>>, "code_point_view is a view");
+static_assert(std::ranges::borrowed_range<utf::code_point_view<char32_t>>, "code_point_view is borrowed");
+static_assert(std::ranges::bidirectional_range<utf::transcode_view<char16_t, char8_t>>, "transcode_view is bidirectional");
+static_assert(std::ranges::view<utf::transcode_view<char8_t, char32_t>>, "transcode_view is a view");
+static_assert(std::ranges::borrowed_range<utf::transcode_view<char32_t, char16_t>>, "transcode_view is borrowed");
+
+namespace {
+    using utf::conversion::status_e;
+
+    int failures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            failures++;
+            std::fprintf(stderr, "failed: %s\n", what);
+        }
+    }
+} // namespace
+
+int main() {
+    const std::u8string_view  utf8  = u8"ключ, κλειδί, 🔑";
+    const std::u16string_view utf16 = u"ключ, κλειδί, 🔑";
+    const std::u32string_view utf32 = U"ключ, κλειδί, 🔑";
+
+    std::u16string to_utf16;
+    std::u32string to_utf32;
+    std::u8string  to_utf8;
+    check(utf::conversion::utf8_to_utf16(utf8, to_utf16, true) == status_e::success && to_utf16 == utf16, "utf8_to_utf16");
+    check(utf::conversion::utf8_to_utf32(utf8, to_utf32, true) == status_e::success && to_utf32 == utf32, "utf8_to_utf32");
+    check(utf::conversion::utf16_to_utf8(utf16, to_utf8, true) == status_e::success && to_utf8 == utf8, "utf16_to_utf8");
+    to_utf8.clear();
+    check(utf::conversion::utf32_to_utf8(utf32, to_utf8, true) == status_e::success && to_utf8 == utf8, "utf32_to_utf8");
+
+    char8_t buffer[64] = {};
+    const utf::conversion::conversion_result_t written = utf::conversion::utf32_to_utf8(utf32, buffer, sizeof(buffer), true);
+    check(written.status == status_e::success && std::u8string_view(buffer, written.written) == utf8, "utf32_to_utf8 into a buffer");
+
+    const utf::conversion::conversion_result_t replaced = utf::conversion::convert<utf::conversion::error_policy_e::replace>(std::u8string_view(u8"a\xFF" "b"), to_utf16);
+    check(replaced.status == status_e::success && replaced.replacements == 1 && to_utf16 == u"a�b", "convert<replace>");
+
+    utf::stream_converter<char8_t, char16_t> converter(true);
+    to_utf16.clear();
+    check(converter.convert(utf8.substr(0, 1), to_utf16) == status_e::success, "stream_converter, first chunk");
+    check(converter.convert(utf8.substr(1), to_utf16) == status_e::success && converter.finish(to_utf16) == status_e::success && to_utf16 == utf16, "stream_converter");
+
+    check(utf::validate_utf8(utf8, true).status == status_e::success, "validate_utf8");
+    check(utf::length::utf16_from_utf8(utf8) == utf16.size(), "utf16_from_utf8");
+    check(utf::count_code_points(utf8) == utf32.size(), "count_code_points");
+    check(utf::truncate_to_code_points(utf8, 1) == 2, "truncate_to_code_points");
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all UTF-8 functions linked and passed\n");
+    return 0;
+}
@@ -0,0 +1,487 @@
+// Differential fuzz target: every conversion entry point must produce the same code units and status as the reference
+// conversions in reference.hpp, on every SIMD tier the CPU supports.
+// The input is read as UTF-8, UTF-16 and UTF-32 (in native byte order) and converted in all six directions, both with and
+// without comply_with_standard, and with every error policy. The lazy views are checked in both directions.
+//
+// Built with UTFUTILS_LIBFUZZER defined (and -fsanitize=fuzzer) this is a libFuzzer target. Otherwise it is a standalone
+// driver: it replays the files given on the command line, or checks random inputs when there are none.
+//     utf-utils-fuzz [--iterations N] [--seed N] [file...]
+
+#include "reference.hpp"
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using utf::conversion::error_policy_e;
+    using utf::conversion::status_e;
+
+    // what is being checked, printed on failure
+    struct context_t {
+        const char* direction = "";
+        const char* entry     = "";
+        int         tier      = 0;
+        bool        comply    = false;
+    } context;
+
+    void check(bool condition, const char* what) {
+        if (condition) {
+            return;
+        }
+        std::fprintf(stderr, "mismatch: %s, %s, tier %d, comply_with_standard %d: %s\n",
+                     context.direction, context.entry, context.tier, context.comply ? 1 : 0, what);
+        std::abort();
+    }
+
+    template <typename char_type>
+    char_type swap_bytes(char_type unit) {
+        if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+            return static_cast<char_type>(((unit & 0xFF) << 8) | (unit >> 8));
+        }
+        else {
+            return static_cast<char_type>(((unit & 0xFF) << 24) | ((unit & 0xFF00) << 8) | ((unit >> 8) & 0xFF00) | (unit >> 24));
+        }
+    }
+
+    // the string overloads of the per-direction functions, optionally the parallel ones
+    template <typename from_type, typename to_type>
+    status_e convert_string(const std::basic_string_view<from_type>& in, std::basic_string<to_type>& out, bool comply, const utf::conversion::parallel_options_t* options) {
+        using namespace utf::conversion;
+
+        if constexpr (sizeof(from_type) == sizeof(char8_t) && sizeof(to_type) == sizeof(char16_t)) {
+            return options ? utf8_to_utf16(in, out, comply, *options) : utf8_to_utf16(in, out, comply);
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+            return options ? utf8_to_utf32(in, out, comply, *options) : utf8_to_utf32(in, out, comply);
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char16_t) && sizeof(to_type) == sizeof(char8_t)) {
+            return options ? utf16_to_utf8(in, out, comply, *options) : utf16_to_utf8(in, out, comply);
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+            return options ? utf16_to_utf32(in, out, comply, *options) : utf16_to_utf32(in, out, comply);
+        }
+        else if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+            return options ? utf32_to_utf8(in, out, comply, *options) : utf32_to_utf8(in, out, comply);
+        }
+        else {
+            return options ? utf32_to_utf16(in, out, comply, *options) : utf32_to_utf16(in, out, comply);
+        }
+    }
+
+    template <typename char_type>
+    utf::validation_result_t validate_string(const std::basic_string_view<char_type>& in, bool comply) {
+        if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+            return utf::validate_utf8(in, comply);
+        }
+        else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+            return utf::validate_utf16(in, comply);
+        }
+        else {
+            return utf::validate_utf32(in, comply);
+        }
+    }
+
+    // the byte stream overloads, input in the byte order opposite to the native one, offset bytes into a buffer (an odd offset
+    // leaves the code units misaligned)
+    template <typename from_type, typename to_type>
+    status_e convert_swapped(const std::basic_string<from_type>& in, std::basic_string<to_type>& out, bool comply, std::size_t offset) {
+        using namespace utf::conversion;
+
+        std::string buffer(offset, '\0');
+        for (const from_type unit : in) {
+            const from_type swapped = swap_bytes(unit);
+            buffer.append(reinterpret_cast<const char*>(&swapped), sizeof(swapped));
+        }
+        const std::string_view bytes = std::string_view(buffer).substr(offset);
+        const byte_order_e foreign_order = native_byte_order == byte_order_e::little_endian ? byte_order_e::big_endian : byte_order_e::little_endian;
+
+        if constexpr (sizeof(from_type) == sizeof(char16_t) && sizeof(to_type) == sizeof(char8_t)) {
+            return utf16_to_utf8(bytes, foreign_order, out, comply);
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+            return utf16_to_utf32(bytes, foreign_order, out, comply);
+        }
+        else if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+            return utf32_to_utf8(bytes, foreign_order, out, comply);
+        }
+        else {
+            return utf32_to_utf16(bytes, foreign_order, out, comply);
+        }
+    }
+
+    template <typename to_type>
+    void check_string(status_e status, const std::basic_string<to_type>& out, const reference::converted_t<to_type>& expected) {
+        check(status == expected.status, "status");
+        if (expected.status == status_e::success) {
+            check(out == expected.output, "output");
+        }
+        else {
+            check(out.size() == 1 && out[0] == 0x2A, "output changed on failure");
+        }
+    }
+
+    // every item of a batch must convert as the same string on its own would, failing items take no space in the arena
+    template <typename from_type, typename to_type>
+    void check_batch(const std::vector<std::basic_string_view<from_type>>& items, const utf::conversion::batch_result_t<to_type>& batch, bool comply) {
+        check(batch.items.size() == items.size(), "item count");
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            std::basic_string<to_type> expected;
+            const status_e status = convert_string(items[i], expected, comply, nullptr);
+            check(batch.items[i].status == status, "status");
+            check(batch.items[i].offset == offset, "offset");
+            if (status == status_e::success) {
+                check(batch[i] == expected, "output");
+            }
+            else {
+                check(batch.items[i].length == 0, "length of a failed item");
+            }
+            offset += batch.items[i].length;
+        }
+        check(batch.arena.size() == offset, "arena size");
+    }
+
+    template <typename from_type, typename to_type>
+    void check_comply(const std::basic_string<from_type>& in, bool comply, std::size_t split) {
+        const std::basic_string_view<from_type> sv(in);
+        const reference::converted_t<to_type> expected = reference::convert<to_type>(in, reference::policy_of(comply));
+        const std::basic_string<to_type> sentinel(1, 0x2A);
+        context.comply = comply;
+
+        context.entry = "string";
+        std::basic_string<to_type> out = sentinel;
+        check_string(convert_string(sv, out, comply, nullptr), out, expected);
+
+        // small chunks, so even short inputs are split between threads
+        context.entry = "parallel";
+        utf::conversion::parallel_options_t options;
+        options.thread_count = 3;
+        options.grain_size   = 16;
+        options.threshold    = 0;
+        out = sentinel;
+        check_string(convert_string(sv, out, comply, &options), out, expected);
+
+        if constexpr (sizeof(from_type) != sizeof(char8_t)) {
+            context.entry = "byte order";
+            out = sentinel;
+            check_string(convert_swapped(in, out, comply, 0), out, expected);
+
+            context.entry = "byte order, odd offset";
+            out = sentinel;
+            check_string(convert_swapped(in, out, comply, 1), out, expected);
+        }
+
+        // exact, short and no capacity; the buffer is exactly that large, so the sanitizers see any overflow
+        context.entry = "buffer";
+        for (const std::size_t capacity : { expected.output.size(), expected.output.size() / 2, std::size_t(0) }) {
+            const reference::converted_t<to_type> limited = reference::convert<to_type>(in, reference::policy_of(comply), capacity);
+            std::vector<to_type> buffer(capacity + (capacity == 0));
+            const utf::conversion::conversion_result_t result = utf::conversion::convert(sv, buffer.data(), capacity, comply);
+            check(result.status == limited.status, "status");
+            check(result.read == limited.read, "read");
+            check(result.written == limited.output.size(), "written");
+            check(std::equal(limited.output.begin(), limited.output.end(), buffer.begin()), "output");
+        }
+
+        context.entry = "stream";
+        utf::stream_converter<from_type, to_type> stream(comply);
+        out.clear();
+        status_e status = status_e::success;
+        for (const auto& chunk : { sv.substr(0, split), sv.substr(split, split), sv.substr(std::min(2 * split, sv.size())) }) {
+            status = stream.convert(chunk, out);
+        }
+        status = stream.finish(out);
+        check(status == expected.status, "status");
+        check(status != status_e::success || out == expected.output, "output");
+
+        // the items cut the input anywhere, also inside code points, and one of them is empty
+        context.entry = "batch";
+        const std::size_t first = std::min(split, sv.size());
+        const std::size_t second = std::min(2 * split + 1, sv.size());
+        const std::size_t offsets[] = { 0, first, first, second, sv.size() };
+        std::vector<std::basic_string_view<from_type>> items;
+        for (std::size_t i = 0; i + 1 < std::size(offsets); i++) {
+            items.push_back(sv.substr(offsets[i], offsets[i + 1] - offsets[i]));
+        }
+        utf::conversion::batch_result_t<to_type> batch;
+        utf::conversion::convert_batch(items.data(), items.size(), batch, comply);
+        check_batch(items, batch, comply);
+
+        context.entry = "batch, offsets";
+        utf::conversion::convert_batch(sv, offsets, items.size(), batch, comply);
+        check_batch(items, batch, comply);
+
+        context.entry = "length";
+        if (expected.status == status_e::success) {
+            check(utf::length::converted_length<to_type>(sv) == expected.output.size(), "length");
+        }
+
+        // validation fails where the decoding does, counting and truncation of valid strings stop at the decoded code points
+        const reference::decoded_t decoded = reference::decode(in, reference::policy_of(comply));
+        const bool valid = decoded.items.empty() || decoded.items.back().status == status_e::success;
+
+        context.entry = "validate";
+        const utf::validation_result_t validation = validate_string(sv, comply);
+        check(validation.status == (valid ? status_e::success : decoded.items.back().status), "status");
+        check(validation.position == (valid ? in.size() : decoded.items.back().offset), "position");
+        if (!valid) {
+            return;
+        }
+
+        context.entry = "count";
+        const std::size_t code_points = decoded.items.size();
+        check(utf::count_code_points(sv) == code_points, "code points");
+
+        context.entry = "truncate";
+        for (const std::size_t max_code_points : { std::size_t(0), code_points / 3, code_points / 2 + 1, code_points, code_points + 1 }) {
+            const std::size_t expected_size = max_code_points < code_points ? decoded.items[max_code_points].offset : in.size();
+            check(utf::truncate_to_code_points(sv, max_code_points) == expected_size, "code points");
+        }
+        const std::size_t bytes = in.size() * sizeof(from_type);
+        for (const std::size_t max_bytes : { std::size_t(0), std::size_t(1), bytes / 3, bytes / 2 + 1, bytes - (bytes > 0), bytes }) {
+            std::size_t expected_size = in.size();
+            if (bytes > max_bytes) {
+                // the prefix ends where the last code point starting within the limit does
+                expected_size = 0;
+                for (const reference::item_t& item : decoded.items) {
+                    if (item.offset * sizeof(from_type) > max_bytes) {
+                        break;
+                    }
+                    expected_size = item.offset;
+                }
+            }
+            check(utf::truncate_to_bytes(sv, max_bytes) == expected_size, "bytes");
+        }
+    }
+
+    template <error_policy_e policy, typename from_type, typename to_type>
+    void check_policy(const std::basic_string<from_type>& in) {
+        static const char* const names[] = { "strict policy", "replace policy", "skip policy", "pass_through policy" };
+        context.entry  = names[static_cast<int>(policy)];
+        context.comply = policy == error_policy_e::strict;
+        const reference::converted_t<to_type> expected = reference::convert<to_type>(in, policy);
+        std::basic_string<to_type> out(1, 0x2A);
+        const utf::conversion::conversion_result_t result = utf::conversion::convert<policy>(std::basic_string_view<from_type>(in), out);
+        check_string(result.status, out, expected);
+        check(result.replacements == expected.replacements, "replacements");
+    }
+
+    // the views decode the input the same way in both directions, and transcode it as the conversion functions do
+    template <typename from_type, typename to_type>
+    void check_views(const std::basic_string<from_type>& in) {
+        const std::basic_string_view<from_type> sv(in);
+        const reference::decoded_t decoded = reference::decode_each(in);
+        context.comply = false;
+
+        context.entry = "code points";
+        const utf::code_point_view<from_type> code_points = utf::code_points(sv);
+        std::size_t index = 0;
+        for (auto it = code_points.begin(); it != code_points.end(); ++it, index++) {
+            check(index < decoded.items.size(), "too many code points");
+            check(*it == decoded.items[index].code_point, "code point");
+            check(static_cast<std::size_t>(it.base() - sv.data()) == decoded.items[index].offset, "position");
+        }
+        check(index == decoded.items.size(), "too few code points");
+
+        context.entry = "code points, reverse";
+        for (auto it = code_points.end(); it != code_points.begin();) {
+            --it;
+            check(index > 0, "too many code points");
+            index--;
+            check(*it == decoded.items[index].code_point, "code point");
+            check(static_cast<std::size_t>(it.base() - sv.data()) == decoded.items[index].offset, "position");
+        }
+        check(index == 0, "too few code points");
+
+        context.entry = "transcode";
+        std::basic_string<to_type> expected;
+        for (const reference::item_t& item : decoded.items) {
+            reference::encode(item.code_point, expected);
+        }
+        const utf::transcode_view<to_type, from_type> units = utf::transcode<to_type>(sv);
+        const std::basic_string<to_type> forward(units.begin(), units.end());
+        check(forward == expected, "output");
+
+        std::basic_string<to_type> converted;
+        if (convert_string(sv, converted, false, nullptr) == status_e::success) {
+            check(forward == converted, "output differs from the conversion");
+        }
+
+        context.entry = "transcode, reverse";
+        std::basic_string<to_type> backward;
+        for (auto it = units.end(); it != units.begin();) {
+            backward.push_back(*--it);
+        }
+        check(std::equal(backward.rbegin(), backward.rend(), expected.begin(), expected.end()), "output");
+    }
+
+    template <typename from_type, typename to_type>
+    void check_direction(const char* direction, const std::basic_string<from_type>& in, std::size_t split) {
+        context.direction = direction;
+        check_comply<from_type, to_type>(in, false, split);
+        check_comply<from_type, to_type>(in, true, split);
+
+        check_policy<error_policy_e::strict, from_type, to_type>(in);
+        check_policy<error_policy_e::replace, from_type, to_type>(in);
+        check_policy<error_policy_e::skip, from_type, to_type>(in);
+        check_policy<error_policy_e::pass_through, from_type, to_type>(in);
+
+        check_views<from_type, to_type>(in);
+    }
+
+    template <typename char_type>
+    std::basic_string<char_type> units_of(const uint8_t* data, std::size_t size) {
+        std::basic_string<char_type> units(size / sizeof(char_type), 0);
+        if (!units.empty()) {
+            std::memcpy(&units[0], data, units.size() * sizeof(char_type));
+        }
+        return units;
+    }
+
+    void check_input(const uint8_t* data, std::size_t size) {
+        const std::basic_string<char8_t>  utf8  = units_of<char8_t>(data, size);
+        const std::basic_string<char16_t> utf16 = units_of<char16_t>(data, size);
+        const std::basic_string<char32_t> utf32 = units_of<char32_t>(data, size);
+        // split streams at a place that depends on the input, so the fuzzer can move it
+        const std::size_t split = size > 0 ? data[0] % (size / 2 + 1) : 0;
+
+        const utf::simd_tier_e active_tier = utf::active_simd_tier();
+        for (int tier = 0; tier <= static_cast<int>(utf::supported_simd_tier()); tier++) {
+            utf::set_simd_tier(static_cast<utf::simd_tier_e>(tier));
+            context.tier = tier;
+
+            check_direction<char8_t, char16_t>("utf8_to_utf16", utf8, split);
+            check_direction<char8_t, char32_t>("utf8_to_utf32", utf8, split);
+            check_direction<char16_t, char8_t>("utf16_to_utf8", utf16, split / sizeof(char16_t));
+            check_direction<char16_t, char32_t>("utf16_to_utf32", utf16, split / sizeof(char16_t));
+            check_direction<char32_t, char8_t>("utf32_to_utf8", utf32, split / sizeof(char32_t));
+            check_direction<char32_t, char16_t>("utf32_to_utf16", utf32, split / sizeof(char32_t));
+        }
+        utf::set_simd_tier(active_tier);
+    }
+} // namespace
+
+#if defined(UTFUTILS_LIBFUZZER)
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+    check_input(data, size);
+    return 0;
+}
+#else
+namespace {
+    // Code points near the boundaries of the encodings, surrogates and values out of the Unicode range.
+    char32_t interesting_code_point(std::mt19937& rng) {
+        static const char32_t boundaries[] = { 0x00, 0x7F, 0x80, 0x7FF, 0x800, 0xD7FF, 0xD800, 0xDBFF, 0xDC00, 0xDFFF, 0xE000,
+                                               0xFFFD, 0xFFFF, 0x10000, 0x10FFFF, 0x110000, 0xFFFFFFFF };
+        switch (rng() % 8) {
+        case 0:  return boundaries[rng() % (sizeof(boundaries) / sizeof(boundaries[0]))];
+        case 1:  return 0x80 + rng() % 0x780;
+        case 2:  return 0x800 + rng() % 0xF800;
+        case 3:  return 0x10000 + rng() % 0x100000;
+        default: return 0x20 + rng() % 0x5F;
+        }
+    }
+
+    // A string in one of the encodings, made of runs of ASCII and interesting code points, then damaged a little.
+    std::vector<uint8_t> random_input(std::mt19937& rng) {
+        const std::size_t length = rng() % 16 == 0 ? rng() % 4096 : rng() % 160;
+        std::u32string code_points;
+        while (code_points.size() < length) {
+            const std::size_t run = rng() % 4 == 0 ? rng() % 80 : 1;
+            const bool ascii = rng() % 2 == 0;
+            for (std::size_t i = 0; i < run; i++) {
+                code_points.push_back(ascii ? 0x20 + rng() % 0x5F : interesting_code_point(rng));
+            }
+        }
+
+        std::vector<uint8_t> bytes;
+        const auto append = [&bytes](const auto& units) {
+            const auto* first = reinterpret_cast<const uint8_t*>(units.data());
+            bytes.insert(bytes.end(), first, first + units.size() * sizeof(units[0]));
+        };
+        switch (rng() % 3) {
+        case 0: {
+            std::basic_string<char8_t> utf8;
+            for (const char32_t code_point : code_points) {
+                reference::encode(code_point & 0x1FFFFF, utf8);
+            }
+            append(utf8);
+            break;
+        }
+        case 1: {
+            std::u16string utf16;
+            for (const char32_t code_point : code_points) {
+                reference::encode(code_point & 0x1FFFFF, utf16);
+            }
+            append(utf16);
+            break;
+        }
+        default:
+            append(code_points);
+            break;
+        }
+
+        const std::size_t damages = rng() % 4;
+        for (std::size_t i = 0; i < damages && !bytes.empty(); i++) {
+            const std::size_t position = rng() % bytes.size();
+            switch (rng() % 3) {
+            case 0:  bytes[position] = static_cast<uint8_t>(rng()); break;
+            case 1:  bytes.erase(bytes.begin() + position); break;
+            default: bytes.insert(bytes.begin() + position, static_cast<uint8_t>(0x80 + rng() % 0x80)); break;
+            }
+        }
+        return bytes;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t iterations = 1000;
+    uint32_t    seed       = 1;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        if (argument == "--iterations" && i + 1 < argc) {
+            iterations = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            files.push_back(argument);
+        }
+    }
+
+    for (const std::string& file : files) {
+        std::ifstream stream(file, std::ios::binary);
+        if (!stream) {
+            std::fprintf(stderr, "can not open %s\n", file.c_str());
+            return 1;
+        }
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        check_input(bytes.data(), bytes.size());
+    }
+    if (!files.empty()) {
+        std::printf("%zu files passed\n", files.size());
+        return 0;
+    }
+
+    std::mt19937 rng(seed);
+    for (std::size_t i = 0; i < iterations; i++) {
+        const std::vector<uint8_t> bytes = random_input(rng);
+        check_input(bytes.data(), bytes.size());
+    }
+    std::printf("%zu random inputs passed (seed %u)\n", iterations, seed);
+    return 0;
+}
+#endif
@@ -0,0 +1,54 @@
+// C++17 consumer of the compile-time literal conversion: UTFUTILS_LITERAL is checked with static_assert, and a malformed
+// array converted at run time must come back with replacement characters instead of hanging.
+//     utf-utils-literals
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <cstdio>
+#include <string_view>
+
+namespace {
+    using u8view = std::basic_string_view<char8_t>;
+
+    // u8 literals are arrays of char before C++20, so the expected UTF-8 is spelled out as code units
+    constexpr char8_t multi_byte[]    = { 0xD0, 0xBA, 0xD0, 0xBB, 0xCE, 0xBA };
+    constexpr char8_t supplementary[] = { 0x61, 0xF0, 0x9F, 0x94, 0x91 };
+    constexpr char8_t surrogate[]     = { 0x61, 0xED, 0xA0, 0x80 };
+
+    static_assert(UTFUTILS_LITERAL(char16_t, u8"клκ").view() == u"клκ", "multi-byte UTF-8 to UTF-16");
+    static_assert(UTFUTILS_LITERAL(char32_t, u8"клκ").view() == U"клκ", "multi-byte UTF-8 to UTF-32");
+    static_assert(UTFUTILS_LITERAL(char8_t, u"клκ").view() == u8view(multi_byte, std::size(multi_byte)), "multi-byte UTF-16 to UTF-8");
+    static_assert(UTFUTILS_LITERAL(char8_t, U"a🔑").view() == u8view(supplementary, std::size(supplementary)), "supplementary UTF-32 to UTF-8");
+    static_assert(UTFUTILS_LITERAL(char16_t, U"a🔑").view() == u"a\xD83D\xDD11", "supplementary UTF-32 to UTF-16");
+    static_assert(UTFUTILS_LITERAL(char32_t, u"a🔑").view() == U"a\x1F511", "supplementary UTF-16 to UTF-32");
+    static_assert(UTFUTILS_LITERAL(char8_t, u"a\xD800").view() == u8view(surrogate, std::size(surrogate)), "lone surrogate, lenient");
+    static_assert(UTFUTILS_LITERAL(char32_t, u"a\xD800").view() == U"a\xD800", "lone surrogate to UTF-32, lenient");
+    static_assert(UTFUTILS_LITERAL(char16_t, u8"").size() == 0, "empty literal");
+
+    int failures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            failures++;
+            std::fprintf(stderr, "failed: %s\n", what);
+        }
+    }
+} // namespace
+
+int main() {
+    // not constexpr, so the conversion runs at run time; each byte of the truncated sequence is replaced on its own
+    char8_t  malformed_utf8[]  = { 0xFF, 0x61, 0xE2, 0x82, 0 };
+    char32_t malformed_utf32[] = { 0x110000, 0x61, 0 };
+
+    check(utf::literals::converted_length<char16_t>(malformed_utf8) == 4, "converted_length of malformed UTF-8");
+    check(utf::literals::convert<char16_t, 4>(malformed_utf8).view() == u"\xFFFD" u"a\xFFFD\xFFFD", "convert of malformed UTF-8");
+    check(utf::literals::converted_length<char16_t>(malformed_utf32) == 2, "converted_length of malformed UTF-32");
+    check(utf::literals::convert<char16_t, 2>(malformed_utf32).view() == u"\xFFFD" u"a", "convert of malformed UTF-32");
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all literal conversions passed\n");
+    return 0;
+}
@@ -0,0 +1,302 @@
+#if !defined(UTFUTILS_TESTS_REFERENCE_H)
+#   define UTFUTILS_TESTS_REFERENCE_H
+
+// Reference conversions the tests check the library against.
+// Written for clarity rather than speed: the input is decoded into code points first and encoded afterwards, one code unit
+// at a time, straight from the tables of the Unicode standard, with no shared code and no vector instructions.
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace reference {
+    using utf::conversion::error_policy_e;
+    using utf::conversion::status_e;
+
+    constexpr char32_t replacement_character = 0xFFFD;
+
+    // One decoded code point, or one error (a maximal subpart of ill-formed input).
+    struct item_t {
+        char32_t    code_point; // the code point to encode, U+FFFD for a replaced error
+        std::size_t offset;     // position of the first code unit in the input
+        status_e    status;     // success, or the status a conversion stopping here returns
+    };
+
+    struct decoded_t {
+        std::vector<item_t> items;
+        std::size_t         size = 0; // number of input code units
+    };
+
+    inline bool is_surrogate(char32_t code_point) {
+        return code_point >= 0xD800 && code_point <= 0xDFFF;
+    }
+
+    inline error_policy_e policy_of(bool comply_with_standard) {
+        return comply_with_standard ? error_policy_e::strict : error_policy_e::pass_through;
+    }
+
+    // Table 3-7 of the Unicode standard, with surrogates (ED A0..BF) allowed if asked.
+    inline bool second_byte_range(unsigned lead_byte, bool allow_surrogates, unsigned& length, unsigned& lower, unsigned& upper) {
+        lower = 0x80;
+        upper = 0xBF;
+        if (lead_byte >= 0xC2 && lead_byte <= 0xDF) {
+            length = 2;
+        }
+        else if (lead_byte >= 0xE0 && lead_byte <= 0xEF) {
+            length = 3;
+            if (lead_byte == 0xE0) {
+                lower = 0xA0;
+            }
+            if (lead_byte == 0xED && !allow_surrogates) {
+                upper = 0x9F;
+            }
+        }
+        else if (lead_byte >= 0xF0 && lead_byte <= 0xF4) {
+            length = 4;
+            if (lead_byte == 0xF0) {
+                lower = 0x90;
+            }
+            if (lead_byte == 0xF4) {
+                upper = 0x8F;
+            }
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    // Number of bytes of a well-formed sequence at i (0 if ill-formed), its code point goes to code_point and the length of
+    // the longest prefix of a well-formed sequence goes to maximal_subpart.
+    inline std::size_t utf8_sequence(const std::basic_string<char8_t>& in, std::size_t i, bool allow_surrogates, char32_t& code_point, std::size_t& maximal_subpart) {
+        const unsigned lead_byte = in[i];
+        maximal_subpart = 1;
+        if (lead_byte < 0x80) {
+            code_point = lead_byte;
+            return 1;
+        }
+
+        unsigned length = 0, lower = 0, upper = 0;
+        if (!second_byte_range(lead_byte, allow_surrogates, length, lower, upper)) {
+            return 0;
+        }
+        code_point = lead_byte & (0xFF >> (length + 1));
+        for (unsigned k = 1; k < length; k++) {
+            const unsigned byte = i + k < in.size() ? in[i + k] : 0;
+            if (i + k >= in.size() || byte < (k == 1 ? lower : 0x80) || byte > (k == 1 ? upper : 0xBF)) {
+                return 0;
+            }
+            code_point = (code_point << 6) | (byte & 0x3F);
+            maximal_subpart++;
+        }
+        return length;
+    }
+
+    inline decoded_t decode(const std::basic_string<char8_t>& in, error_policy_e policy) {
+        decoded_t decoded;
+        decoded.size = in.size();
+
+        for (std::size_t i = 0; i < in.size();) {
+            char32_t    code_point = 0;
+            std::size_t subpart    = 0;
+            std::size_t length     = utf8_sequence(in, i, true, code_point, subpart);
+            status_e    status     = length == 0 ? status_e::undefined_error : status_e::success;
+
+            if (length != 0 && is_surrogate(code_point) && policy != error_policy_e::pass_through) {
+                status = status_e::non_standard_encoding;
+            }
+            if (status == status_e::success) {
+                decoded.items.push_back({ code_point, i, status });
+                i += length;
+                continue;
+            }
+
+            if (policy == error_policy_e::strict || policy == error_policy_e::pass_through) {
+                decoded.items.push_back({ 0, i, status });
+                return decoded;
+            }
+            // surrogates are never a part of a well-formed sequence, so they do not extend the maximal subpart
+            utf8_sequence(in, i, false, code_point, subpart);
+            decoded.items.push_back({ replacement_character, i, status });
+            i += subpart;
+        }
+        return decoded;
+    }
+
+    inline decoded_t decode(const std::basic_string<char16_t>& in, error_policy_e policy) {
+        decoded_t decoded;
+        decoded.size = in.size();
+
+        for (std::size_t i = 0; i < in.size(); i++) {
+            const char32_t unit = in[i];
+            if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < in.size() && in[i + 1] >= 0xDC00 && in[i + 1] <= 0xDFFF) {
+                decoded.items.push_back({ 0x10000 + ((unit - 0xD800) << 10) + (in[i + 1] - 0xDC00), i, status_e::success });
+                i++;
+            }
+            else if (!is_surrogate(unit) || policy == error_policy_e::pass_through) {
+                decoded.items.push_back({ unit, i, status_e::success });
+            }
+            else if (policy == error_policy_e::strict) {
+                decoded.items.push_back({ 0, i, status_e::non_standard_encoding });
+                return decoded;
+            }
+            else {
+                decoded.items.push_back({ replacement_character, i, status_e::non_standard_encoding });
+            }
+        }
+        return decoded;
+    }
+
+    inline decoded_t decode(const std::basic_string<char32_t>& in, error_policy_e policy) {
+        decoded_t decoded;
+        decoded.size = in.size();
+
+        for (std::size_t i = 0; i < in.size(); i++) {
+            const char32_t code_point = in[i];
+            status_e       status     = status_e::success;
+            if (code_point > 0x10FFFF) {
+                status = status_e::undefined_error;
+            }
+            else if (is_surrogate(code_point) && policy != error_policy_e::pass_through) {
+                status = status_e::non_standard_encoding;
+            }
+
+            if (status == status_e::success) {
+                decoded.items.push_back({ code_point, i, status });
+            }
+            else if (policy == error_policy_e::strict || policy == error_policy_e::pass_through) {
+                decoded.items.push_back({ 0, i, status });
+                return decoded;
+            }
+            else {
+                decoded.items.push_back({ replacement_character, i, status });
+            }
+        }
+        return decoded;
+    }
+
+    // What the code point iterators yield: lenient decoding which never stops, each code unit that can not be decoded is
+    // replaced on its own.
+    inline decoded_t decode_each(const std::basic_string<char8_t>& in) {
+        decoded_t decoded;
+        decoded.size = in.size();
+
+        for (std::size_t i = 0; i < in.size();) {
+            char32_t    code_point = 0;
+            std::size_t subpart    = 0;
+            const std::size_t length = utf8_sequence(in, i, true, code_point, subpart);
+            if (length == 0) {
+                decoded.items.push_back({ replacement_character, i, status_e::undefined_error });
+                i++;
+                continue;
+            }
+            decoded.items.push_back({ code_point, i, status_e::success });
+            i += length;
+        }
+        return decoded;
+    }
+
+    inline decoded_t decode_each(const std::basic_string<char16_t>& in) {
+        return decode(in, error_policy_e::pass_through);
+    }
+
+    inline decoded_t decode_each(const std::basic_string<char32_t>& in) {
+        decoded_t decoded;
+        decoded.size = in.size();
+
+        for (std::size_t i = 0; i < in.size(); i++) {
+            if (in[i] > 0x10FFFF) {
+                decoded.items.push_back({ replacement_character, i, status_e::undefined_error });
+            }
+            else {
+                decoded.items.push_back({ in[i], i, status_e::success });
+            }
+        }
+        return decoded;
+    }
+
+    template <typename to_type>
+    void encode(char32_t code_point, std::basic_string<to_type>& out) {
+        if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+            if (code_point < 0x80) {
+                out.push_back(static_cast<to_type>(code_point));
+            }
+            else if (code_point < 0x800) {
+                out.push_back(static_cast<to_type>(0xC0 | (code_point >> 6)));
+                out.push_back(static_cast<to_type>(0x80 | (code_point & 0x3F)));
+            }
+            else if (code_point < 0x10000) {
+                out.push_back(static_cast<to_type>(0xE0 | (code_point >> 12)));
+                out.push_back(static_cast<to_type>(0x80 | ((code_point >> 6) & 0x3F)));
+                out.push_back(static_cast<to_type>(0x80 | (code_point & 0x3F)));
+            }
+            else {
+                out.push_back(static_cast<to_type>(0xF0 | (code_point >> 18)));
+                out.push_back(static_cast<to_type>(0x80 | ((code_point >> 12) & 0x3F)));
+                out.push_back(static_cast<to_type>(0x80 | ((code_point >> 6) & 0x3F)));
+                out.push_back(static_cast<to_type>(0x80 | (code_point & 0x3F)));
+            }
+        }
+        else if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+            if (code_point < 0x10000) {
+                out.push_back(static_cast<to_type>(code_point));
+            }
+            else {
+                out.push_back(static_cast<to_type>(0xD800 + ((code_point - 0x10000) >> 10)));
+                out.push_back(static_cast<to_type>(0xDC00 + ((code_point - 0x10000) & 0x3FF)));
+            }
+        }
+        else {
+            out.push_back(static_cast<to_type>(code_point));
+        }
+    }
+
+    // What the library returns when converting into a buffer of the given capacity.
+    template <typename to_type>
+    struct converted_t {
+        status_e                   status       = status_e::success;
+        std::size_t                read         = 0;
+        std::basic_string<to_type> output;
+        std::size_t                replacements = 0;
+    };
+
+    template <typename to_type>
+    converted_t<to_type> convert(const decoded_t& decoded, error_policy_e policy, std::size_t capacity = std::size_t(-1)) {
+        converted_t<to_type> converted;
+
+        for (const item_t& item : decoded.items) {
+            converted.read = item.offset;
+            if (item.status != status_e::success) {
+                if (policy == error_policy_e::strict || policy == error_policy_e::pass_through) {
+                    converted.status = item.status;
+                    return converted;
+                }
+                if (policy == error_policy_e::skip) {
+                    converted.replacements++;
+                    continue;
+                }
+            }
+
+            std::basic_string<to_type> sequence;
+            encode(item.code_point, sequence);
+            if (converted.output.size() + sequence.size() > capacity) {
+                converted.status = status_e::output_too_small;
+                return converted;
+            }
+            converted.output += sequence;
+            converted.replacements += item.status != status_e::success;
+        }
+
+        converted.read = decoded.size;
+        return converted;
+    }
+
+    template <typename to_type, typename from_type>
+    converted_t<to_type> convert(const std::basic_string<from_type>& in, error_policy_e policy, std::size_t capacity = std::size_t(-1)) {
+        return convert<to_type>(decode(in, policy), policy, capacity);
+    }
+} // namespace reference
+
+#endif // !defined(UTFUTILS_TESTS_REFERENCE_H)
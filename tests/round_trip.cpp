@@ -0,0 +1,147 @@
+// Round-trip property test: on every SIMD tier the CPU supports, well-formed strings converted in all six directions match
+// the reference conversions in reference.hpp, and convert back to themselves (UTF-8 -> UTF-16 -> UTF-32 -> UTF-8 and the
+// other way round), both with and without comply_with_standard.
+// Without comply_with_standard lone surrogates survive the round trip as well, as long as a high one is not followed by a low
+// one (UTF-16 can not tell such a couple from a pair).
+//     utf-utils-round-trip [--iterations N] [--seed N]
+
+#include "reference.hpp"
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+    using utf::conversion::status_e;
+
+    int failures = 0;
+
+    void check(bool condition, const char* what, int tier, bool comply, std::size_t length) {
+        if (!condition && failures++ < 10) {
+            std::fprintf(stderr, "failed: %s, tier %d, comply_with_standard %d, %zu code points\n", what, tier, comply ? 1 : 0, length);
+        }
+    }
+
+    template <typename to_type, typename from_type>
+    std::basic_string<to_type> convert(const std::basic_string<from_type>& in, bool comply, status_e& status) {
+        std::basic_string<to_type> out;
+        // sized by the length functions, so a wrong length shows up as output_too_small
+        out.resize(utf::length::converted_length<to_type>(std::basic_string_view<from_type>(in)));
+        const utf::conversion::conversion_result_t result = utf::conversion::convert(std::basic_string_view<from_type>(in), out.data(), out.size(), comply);
+        status = result.status;
+        out.resize(result.written);
+        return out;
+    }
+
+    template <typename to_type>
+    std::basic_string<to_type> encode(const std::u32string& code_points) {
+        std::basic_string<to_type> out;
+        for (const char32_t code_point : code_points) {
+            reference::encode(code_point, out);
+        }
+        return out;
+    }
+
+    // Runs of one kind of characters, so the strings have long ASCII runs for the vector paths as well as every sequence
+    // length next to each other. Lone surrogates only if asked, and never a high one followed by a low one.
+    std::u32string random_code_points(std::mt19937& rng, std::size_t length, bool with_surrogates) {
+        std::u32string code_points;
+        while (code_points.size() < length) {
+            const uint32_t kind = rng() % (with_surrogates ? 6 : 5);
+            const std::size_t run = 1 + (rng() % 3 == 0 ? rng() % 100 : rng() % 4);
+            for (std::size_t i = 0; i < run && code_points.size() < length; i++) {
+                char32_t code_point = 0;
+                switch (kind) {
+                case 0:  code_point = rng() % 0x80; break;
+                case 1:  code_point = 0x80 + rng() % 0x780; break;
+                case 2:  code_point = 0x800 + rng() % 0xF800; break;
+                case 3:  code_point = 0x10000 + rng() % 0x100000; break;
+                case 4:  code_point = rng() % 2 ? 0x7F + rng() % 2 : (rng() % 2 ? 0xFFFF + rng() % 2 : 0x10FFFF); break;
+                default: code_point = 0xD800 + rng() % 0x800; break;
+                }
+                if (reference::is_surrogate(code_point) && !with_surrogates) {
+                    code_point = 0xFFFD;
+                }
+                if (code_point >= 0xDC00 && code_point <= 0xDFFF && !code_points.empty() && code_points.back() >= 0xD800 && code_points.back() <= 0xDBFF) {
+                    code_point = 0x41;
+                }
+                code_points.push_back(code_point);
+            }
+        }
+        return code_points;
+    }
+
+    void check_round_trip(const std::u32string& code_points, int tier, bool comply) {
+        const std::basic_string<char8_t>  utf8  = encode<char8_t>(code_points);
+        const std::basic_string<char16_t> utf16 = encode<char16_t>(code_points);
+        const std::u32string&             utf32 = code_points;
+        // surrogates are ill-formed, so strict conversions must fail on them, whichever the direction
+        const bool has_surrogate = std::any_of(code_points.begin(), code_points.end(), reference::is_surrogate);
+        const status_e expected = has_surrogate && comply ? status_e::non_standard_encoding : status_e::success;
+        const std::size_t length = code_points.size();
+        status_e status = status_e::success;
+
+        const auto check_direction = [&](const auto& out, const auto& wanted, const char* what) {
+            check(status == expected, what, tier, comply, length);
+            check(status != status_e::success || out == wanted, what, tier, comply, length);
+        };
+
+        check_direction(convert<char16_t>(utf8, comply, status), utf16, "utf8_to_utf16");
+        check_direction(convert<char32_t>(utf8, comply, status), utf32, "utf8_to_utf32");
+        check_direction(convert<char8_t>(utf16, comply, status), utf8, "utf16_to_utf8");
+        check_direction(convert<char32_t>(utf16, comply, status), utf32, "utf16_to_utf32");
+        check_direction(convert<char8_t>(utf32, comply, status), utf8, "utf32_to_utf8");
+        check_direction(convert<char16_t>(utf32, comply, status), utf16, "utf32_to_utf16");
+
+        if (expected != status_e::success) {
+            return;
+        }
+        status_e first = status_e::success, second = status_e::success, third = status_e::success;
+        const std::basic_string<char8_t> forward = convert<char8_t>(convert<char32_t>(convert<char16_t>(utf8, comply, first), comply, second), comply, third);
+        check(first == status_e::success && second == status_e::success && third == status_e::success && forward == utf8, "utf8 -> utf16 -> utf32 -> utf8", tier, comply, length);
+        const std::basic_string<char8_t> backward = convert<char8_t>(convert<char16_t>(convert<char32_t>(utf8, comply, first), comply, second), comply, third);
+        check(first == status_e::success && second == status_e::success && third == status_e::success && backward == utf8, "utf8 -> utf32 -> utf16 -> utf8", tier, comply, length);
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t iterations = 2000;
+    uint32_t    seed       = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string argument = argv[i];
+        if (argument == "--iterations") {
+            iterations = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (argument == "--seed") {
+            seed = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    std::mt19937 rng(seed);
+    const utf::simd_tier_e active_tier = utf::active_simd_tier();
+    for (std::size_t i = 0; i < iterations; i++) {
+        // every length up to a few vectors, then longer strings now and then
+        const std::size_t length = i < 300 ? i : (rng() % 8 == 0 ? rng() % 5000 : rng() % 300);
+        const bool with_surrogates = i % 3 == 2;
+        const std::u32string code_points = random_code_points(rng, length, with_surrogates);
+
+        for (int tier = 0; tier <= static_cast<int>(utf::supported_simd_tier()); tier++) {
+            utf::set_simd_tier(static_cast<utf::simd_tier_e>(tier));
+            check_round_trip(code_points, tier, false);
+            check_round_trip(code_points, tier, true);
+        }
+    }
+    utf::set_simd_tier(active_tier);
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed (seed %u)\n", failures, seed);
+        return 1;
+    }
+    std::printf("%zu strings passed (seed %u)\n", iterations, seed);
+    return 0;
+}
@@ -0,0 +1,299 @@
+// Throughput regression check: every conversion direction on every SIMD tier the CPU supports, on ASCII and on mixed text,
+// must stay within the tolerance of a baseline recorded on the same machine.
+// Throughput is measured relative to memcpy of the same input, so the baseline carries over changes of clock speed and load,
+// though not a move to another machine: the baseline is never shared, record it where the check runs.
+//     utf-utils-throughput --baseline FILE [--record] [--samples N] [--tolerance PERCENT]
+// Each result is the median of N samples (9 by default), with --record as well as without.
+// Exits with 77 (skipped) in unoptimized builds and if there is no baseline yet.
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr int         skipped      = 77;
+    constexpr std::size_t corpus_size  = std::size_t(1) << 18; // code points
+    constexpr int         repetitions  = 15;
+    constexpr std::size_t input_offset  = 0;    // within a page
+    constexpr std::size_t output_offset = 2048; // within a page
+
+    const char* const tier_names[] = { "scalar", "sse2", "sse42", "avx2", "avx512" };
+
+    std::u32string make_code_points(bool mixed) {
+        std::mt19937 rng(mixed ? 2 : 1);
+        std::u32string code_points(corpus_size, 0);
+        for (char32_t& code_point : code_points) {
+            const uint32_t percent = rng() % 100;
+            code_point = !mixed || percent < 40 ? 0x20 + rng() % 0x5F
+                       : percent < 60 ? 0xA0 + rng() % 0x760
+                       : percent < 85 ? 0x800 + rng() % 0xD000
+                       : 0x10000 + rng() % 0x100000;
+        }
+        return code_points;
+    }
+
+    // best of a few runs, the least disturbed one
+    template <typename function_type>
+    double best_seconds(const function_type& function) {
+        double best = 1e9;
+        for (int i = 0; i < repetitions; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    // Memory at a fixed offset within a page. Where the heap puts the buffers changes the speed (input and output at the same
+    // offset within a page alias in the store buffer), so the buffers are placed the same way in every run.
+    template <typename char_type>
+    class placed_buffer_t {
+    public:
+        placed_buffer_t(std::size_t size, std::size_t page_offset)
+            : m_storage(size * sizeof(char_type) + 2 * page_size) {
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_storage.data());
+            m_data = reinterpret_cast<char_type*>((address + page_size - 1) / page_size * page_size + page_offset);
+        }
+
+        char_type* data() {
+            return m_data;
+        }
+
+    private:
+        static constexpr std::size_t page_size = 4096;
+
+        std::vector<char> m_storage;
+        char_type*        m_data;
+    };
+
+    // bytes per second, copying a buffer as large as the corpora many times over, so the time is long enough to measure
+    double memcpy_throughput() {
+        const std::size_t bytes = corpus_size * sizeof(char32_t);
+        const int         times = 16;
+        static placed_buffer_t<char> from(bytes, input_offset), to(bytes, output_offset);
+        std::memset(from.data(), 'a', bytes);
+
+        const double seconds = best_seconds([&] {
+            for (int i = 0; i < times; i++) {
+                from.data()[i] = static_cast<char>(i);
+                std::memcpy(to.data(), from.data(), bytes);
+            }
+            volatile char sink = to.data()[bytes / 2];
+            (void)sink;
+        });
+        return bytes * times / seconds;
+    }
+
+    struct corpus_t {
+        std::basic_string<char8_t> utf8;
+        std::u16string             utf16;
+        std::u32string             utf32;
+
+        template <typename char_type>
+        const std::basic_string<char_type>& get() const {
+            if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+                return utf8;
+            }
+            else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+                return utf16;
+            }
+            else {
+                return utf32;
+            }
+        }
+    };
+
+    struct kernel_t {
+        std::string name;
+        int         tier;
+        double (*measure)(const corpus_t& corpus); // bytes per second
+        const corpus_t* corpus;
+    };
+
+    template <typename from_type, typename to_type>
+    double conversion_throughput(const corpus_t& corpus) {
+        const std::basic_string<from_type>& input = corpus.get<from_type>();
+        placed_buffer_t<from_type> placed_input(input.size(), input_offset);
+        std::copy(input.begin(), input.end(), placed_input.data());
+
+        const std::basic_string_view<from_type> sv(placed_input.data(), input.size());
+        const std::size_t output_size = utf::length::converted_length<to_type>(sv);
+        placed_buffer_t<to_type> output(output_size, output_offset);
+
+        const double seconds = best_seconds([&] {
+            const utf::conversion::conversion_result_t result = utf::conversion::convert(sv, output.data(), output_size);
+            if (result.status != utf::conversion::status_e::success) {
+                std::fprintf(stderr, "the corpus failed to convert\n");
+                std::exit(1);
+            }
+        });
+        return sv.size() * sizeof(from_type) / seconds;
+    }
+
+    // conversion speed divided by memcpy speed measured right after it, so both see the same state of the machine
+    double relative_throughput(const kernel_t& kernel) {
+        const utf::simd_tier_e active_tier = utf::active_simd_tier();
+        utf::set_simd_tier(static_cast<utf::simd_tier_e>(kernel.tier));
+        const double speed = kernel.measure(*kernel.corpus);
+        utf::set_simd_tier(active_tier);
+        return speed / memcpy_throughput();
+    }
+
+    // the median of the samples, so neither a lucky nor an unlucky one decides; samples of a kernel are spread over the run
+    std::map<std::string, double> measure_all(const std::vector<kernel_t>& kernels, int samples) {
+        std::map<std::string, std::vector<double>> runs;
+        for (int sample = 0; sample < samples; sample++) {
+            for (const kernel_t& kernel : kernels) {
+                runs[kernel.name].push_back(relative_throughput(kernel));
+            }
+        }
+        std::map<std::string, double> results;
+        for (auto& [name, values] : runs) {
+            std::sort(values.begin(), values.end());
+            const std::size_t middle = values.size() / 2;
+            results[name] = values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+        }
+        return results;
+    }
+
+    std::vector<kernel_t> list_kernels(const corpus_t& ascii, const corpus_t& mixed) {
+        std::vector<kernel_t> kernels;
+        for (const corpus_t* corpus : { &ascii, &mixed }) {
+            const std::string corpus_name = corpus == &ascii ? "/ascii" : "/mixed";
+            for (int tier = 0; tier <= static_cast<int>(utf::supported_simd_tier()); tier++) {
+                const std::string prefix = std::string(tier_names[tier]) + "/";
+                kernels.push_back({ prefix + "utf8_to_utf16" + corpus_name, tier, conversion_throughput<char8_t, char16_t>, corpus });
+                kernels.push_back({ prefix + "utf8_to_utf32" + corpus_name, tier, conversion_throughput<char8_t, char32_t>, corpus });
+                kernels.push_back({ prefix + "utf16_to_utf8" + corpus_name, tier, conversion_throughput<char16_t, char8_t>, corpus });
+                kernels.push_back({ prefix + "utf16_to_utf32" + corpus_name, tier, conversion_throughput<char16_t, char32_t>, corpus });
+                kernels.push_back({ prefix + "utf32_to_utf8" + corpus_name, tier, conversion_throughput<char32_t, char8_t>, corpus });
+                kernels.push_back({ prefix + "utf32_to_utf16" + corpus_name, tier, conversion_throughput<char32_t, char16_t>, corpus });
+            }
+        }
+        return kernels;
+    }
+
+    corpus_t make_corpus(bool mixed) {
+        corpus_t corpus;
+        corpus.utf32 = make_code_points(mixed);
+        utf::conversion::utf32_to_utf8(corpus.utf32, corpus.utf8);
+        utf::conversion::utf32_to_utf16(corpus.utf32, corpus.utf16);
+        return corpus;
+    }
+
+    // one "name relative_throughput" pair per line, # starts a comment
+    bool read_baseline(const std::string& path, std::map<std::string, double>& baseline) {
+        std::ifstream stream(path);
+        if (!stream) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(stream, line)) {
+            std::istringstream fields(line);
+            std::string name;
+            double value = 0;
+            if (fields >> name >> value && name[0] != '#') {
+                baseline[name] = value;
+            }
+        }
+        return true;
+    }
+
+    bool write_baseline(const std::string& path, const std::map<std::string, double>& results) {
+        std::ofstream stream(path);
+        stream << "# conversion throughput relative to memcpy, written by utf-utils-throughput --record\n";
+        for (const auto& [name, value] : results) {
+            stream << name << ' ' << value << '\n';
+        }
+        return static_cast<bool>(stream);
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string baseline_path;
+    double      tolerance = 30;
+    int         samples   = 9;
+    bool        record    = false;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        if (argument == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        }
+        else if (argument == "--tolerance" && i + 1 < argc) {
+            tolerance = std::strtod(argv[++i], nullptr);
+        }
+        else if (argument == "--samples" && i + 1 < argc) {
+            samples = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (argument == "--record") {
+            record = true;
+        }
+        else {
+            std::fprintf(stderr, "usage: %s --baseline FILE [--record] [--samples N] [--tolerance PERCENT]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (baseline_path.empty()) {
+        std::fprintf(stderr, "no baseline file given\n");
+        return 2;
+    }
+
+#if !defined(NDEBUG)
+    if (!record) {
+        std::printf("skipped: throughput of unoptimized builds is not comparable with the baseline\n");
+        return skipped;
+    }
+#endif
+
+    std::map<std::string, double> baseline;
+    if (!record && !read_baseline(baseline_path, baseline)) {
+        std::printf("skipped: no baseline in %s yet, record it on this machine with --record\n", baseline_path.c_str());
+        return skipped;
+    }
+
+    const corpus_t ascii = make_corpus(false);
+    const corpus_t mixed = make_corpus(true);
+    const std::map<std::string, double> results = measure_all(list_kernels(ascii, mixed), samples);
+
+    if (record) {
+        if (!write_baseline(baseline_path, results)) {
+            std::fprintf(stderr, "can not write %s\n", baseline_path.c_str());
+            return 1;
+        }
+        std::printf("%zu medians of %d samples written to %s\n", results.size(), samples, baseline_path.c_str());
+        return 0;
+    }
+
+    int regressions = 0;
+    std::printf("medians of %d samples\n%-32s %10s %10s %8s\n", samples, "kernel", "baseline", "now", "change");
+    for (const auto& [name, value] : results) {
+        const auto found = baseline.find(name);
+        if (found == baseline.end()) {
+            std::printf("%-32s %10s %10.4f %8s\n", name.c_str(), "-", value, "new");
+            continue;
+        }
+        const double change     = (value / found->second - 1) * 100;
+        const bool   regression = change < -tolerance;
+        regressions += regression;
+        std::printf("%-32s %10.4f %10.4f %+7.1f%%%s\n", name.c_str(), found->second, value, change, regression ? "  REGRESSION" : "");
+    }
+
+    if (regressions > 0) {
+        std::printf("%d kernels are more than %.0f%% slower than the baseline\n", regressions, tolerance);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,552 @@
+// utf-convert: converts a file between UTF-8, UTF-16 and UTF-32 of either byte order.
+// Regular files are memory mapped and converted in chunks, so neither the input nor the output is ever held in memory whole.
+//
+// usage: utf-convert [--from ENCODING] --to ENCODING [--add-bom | --strip-bom] [--strict] INPUT OUTPUT
+//   ENCODING is one of utf-8, utf-16le, utf-16be, utf-32le, utf-32be.
+//   Without --from the encoding is detected from the BOM, UTF-8 is assumed if there is none.
+//   The output gets a BOM if the input has one, unless --add-bom or --strip-bom is given.
+//   INPUT and OUTPUT may be "-" for standard input and output.
+
+#include <utf-utils/utf_utils.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   define UTFCONVERT_MMAP
+#endif
+
+namespace {
+    // both are multiples of every code unit size, so code units are split between chunks only after the BOM
+    constexpr std::size_t chunk_size  = std::size_t(1) << 20;
+    constexpr std::size_t output_size = std::size_t(1) << 20;
+
+    enum class encoding_e { utf8, utf16le, utf16be, utf32le, utf32be };
+
+    struct encoding_info_t {
+        encoding_e  encoding;
+        const char* name;
+        std::size_t unit_size;
+        bool        little_endian;
+        const char* bom;
+        std::size_t bom_size;
+    };
+
+    // UTF-32LE goes before UTF-16LE, as its BOM starts with UTF-16LE one
+    constexpr encoding_info_t encodings[] = {
+        { encoding_e::utf8,    "utf-8",    1, true,  "\xEF\xBB\xBF",     3 },
+        { encoding_e::utf32le, "utf-32le", 4, true,  "\xFF\xFE\x00\x00", 4 },
+        { encoding_e::utf32be, "utf-32be", 4, false, "\x00\x00\xFE\xFF", 4 },
+        { encoding_e::utf16le, "utf-16le", 2, true,  "\xFF\xFE",         2 },
+        { encoding_e::utf16be, "utf-16be", 2, false, "\xFE\xFF",         2 },
+    };
+
+    const encoding_info_t& info(encoding_e encoding) {
+        for (const encoding_info_t& candidate : encodings) {
+            if (candidate.encoding == encoding) {
+                return candidate;
+            }
+        }
+        return encodings[0];
+    }
+
+    bool parse_encoding(std::string_view name, encoding_e& encoding) {
+        for (const encoding_info_t& candidate : encodings) {
+            if (name == candidate.name) {
+                encoding = candidate.encoding;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // returns the encoding whose BOM the data starts with, if any
+    const encoding_info_t* detect_bom(std::string_view data) {
+        for (const encoding_info_t& candidate : encodings) {
+            if (data.substr(0, candidate.bom_size) == std::string_view(candidate.bom, candidate.bom_size)) {
+                return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename char_type>
+    char_type swap_bytes(char_type unit) {
+        if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+            return static_cast<char_type>((unit >> 8) | (unit << 8));
+        }
+        else {
+            return static_cast<char_type>((unit >> 24) | ((unit >> 8) & 0xFF00) | ((unit << 8) & 0xFF0000) | (unit << 24));
+        }
+    }
+
+    // reads the input either through a memory mapping or, for pipes and terminals, with plain reads
+    class input_t {
+    public:
+        ~input_t() {
+#if defined(UTFCONVERT_MMAP)
+            if (m_mapping != nullptr) {
+                munmap(m_mapping, m_mapping_size);
+            }
+#endif
+            if (m_file != nullptr && m_file != stdin) {
+                std::fclose(m_file);
+            }
+        }
+
+        bool open(const char* path) {
+            if (std::strcmp(path, "-") == 0) {
+                m_file = stdin;
+                return true;
+            }
+#if defined(UTFCONVERT_MMAP)
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0) {
+                return false;
+            }
+            struct stat file_stat {};
+            if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+                m_mapping_size = static_cast<std::size_t>(file_stat.st_size);
+                m_mapping      = mmap(nullptr, m_mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m_mapping != MAP_FAILED) {
+                    // the file is read once from the beginning to the end, let the kernel read ahead
+                    posix_madvise(m_mapping, m_mapping_size, POSIX_MADV_SEQUENTIAL);
+                    ::close(fd);
+                    m_mapped = std::string_view(static_cast<const char*>(m_mapping), m_mapping_size);
+                    return true;
+                }
+                m_mapping = nullptr;
+            }
+            ::close(fd);
+#endif
+            m_file = std::fopen(path, "rb");
+            return m_file != nullptr;
+        }
+
+        // returns the next chunk of at most chunk_size bytes, an empty one at the end of the input
+        std::string_view next() {
+            if (m_file == nullptr) {
+#if defined(UTFCONVERT_MMAP)
+                // the previous chunk is converted by now, drop its pages so the memory used does not grow with the file
+                if (!m_chunk.empty()) {
+                    madvise(const_cast<char*>(m_chunk.data()), m_chunk.size(), MADV_DONTNEED);
+                }
+#endif
+                m_chunk = m_mapped.substr(0, chunk_size);
+                m_mapped.remove_prefix(m_chunk.size());
+                return m_chunk;
+            }
+
+            m_buffer.resize(chunk_size);
+            std::size_t size = 0;
+            while (size < chunk_size) {
+                const std::size_t read = std::fread(m_buffer.data() + size, 1, chunk_size - size, m_file);
+                if (read == 0) {
+                    break;
+                }
+                size += read;
+            }
+            return std::string_view(m_buffer.data(), size);
+        }
+
+        bool failed() const {
+            return m_file != nullptr && std::ferror(m_file);
+        }
+
+    private:
+        std::FILE*        m_file         = nullptr;
+        void*             m_mapping      = nullptr;
+        std::size_t       m_mapping_size = 0;
+        std::string_view  m_mapped;
+        std::string_view  m_chunk;
+        std::vector<char> m_buffer;
+    };
+
+    // writes the output through a large buffer
+    class output_t {
+    public:
+        ~output_t() {
+            close();
+        }
+
+        bool open(const char* path) {
+            m_file = std::strcmp(path, "-") == 0 ? stdout : std::fopen(path, "wb");
+            if (m_file != nullptr) {
+                std::setvbuf(m_file, nullptr, _IOFBF, output_size);
+            }
+            return m_file != nullptr;
+        }
+
+        bool write(const void* data, std::size_t size) {
+            return std::fwrite(data, 1, size, m_file) == size;
+        }
+
+        bool close() {
+            if (m_file == nullptr) {
+                return true;
+            }
+            const bool flushed = std::fflush(m_file) == 0;
+            const bool closed  = m_file == stdout || std::fclose(m_file) == 0;
+            m_file = nullptr;
+            return flushed && closed;
+        }
+
+    private:
+        std::FILE* m_file = nullptr;
+    };
+
+    // Cuts the input into pieces which end at code point boundaries, so every piece is validated or converted on its own.
+    // A code point (or code unit) cut by the end of a chunk is held back and completed with the first bytes of the next chunk;
+    // all other pieces point into the chunks themselves.
+    class pieces_t {
+    public:
+        explicit pieces_t(const encoding_info_t& encoding)
+            : m_encoding(encoding) {
+        }
+
+        // calls process with every piece of the chunk, stops as soon as it returns false
+        template <typename function_type>
+        bool split(std::string_view chunk, const function_type& process) {
+            while (!m_held.empty() && !chunk.empty()) {
+                // 4 bytes hold a whole code point in any encoding, so at least one piece is completed
+                const std::size_t taken = std::min(chunk.size(), max_held - m_held.size());
+                m_held.append(chunk.substr(0, taken));
+                chunk.remove_prefix(taken);
+                const std::size_t whole = boundary(m_held);
+                if (whole > 0 && !process(std::string_view(m_held).substr(0, whole))) {
+                    return false;
+                }
+                m_held.erase(0, whole);
+            }
+            const std::size_t whole = boundary(chunk);
+            if (whole > 0 && !process(chunk.substr(0, whole))) {
+                return false;
+            }
+            m_held.append(chunk.substr(whole));
+            return true;
+        }
+
+        // the bytes held back at the end of the input, a cut code point for the library to report (or to pass through)
+        std::string_view held() const {
+            return m_held;
+        }
+
+        // returns true if the input ended in the middle of a code unit
+        bool truncated() const {
+            return m_held.size() % m_encoding.unit_size != 0;
+        }
+
+    private:
+        static constexpr std::size_t max_held = 4;
+
+        // size of the longest prefix which does not end inside a code point
+        std::size_t boundary(std::string_view bytes) const {
+            const std::size_t size = bytes.size() - bytes.size() % m_encoding.unit_size;
+            if (m_encoding.unit_size == sizeof(char8_t)) {
+                // a lead byte among the last 3 bytes whose sequence goes on past them, malformed sequences are left for the library
+                for (std::size_t back = 1; back <= 3 && back <= size; back++) {
+                    const unsigned char byte = static_cast<unsigned char>(bytes[size - back]);
+                    if (byte >> 6 != 0x2) {
+                        const std::size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+                        return length > back ? size - back : size;
+                    }
+                }
+            }
+            else if (m_encoding.unit_size == sizeof(char16_t) && size > 0) {
+                // a high surrogate may pair with the first unit of the next chunk
+                const unsigned char first  = static_cast<unsigned char>(bytes[size - 2]);
+                const unsigned char second = static_cast<unsigned char>(bytes[size - 1]);
+                const unsigned int  unit   = m_encoding.little_endian ? (second << 8 | first) : (first << 8 | second);
+                return unit >= 0xD800 && unit <= 0xDBFF ? size - 2 : size;
+            }
+            return size;
+        }
+
+        const encoding_info_t& m_encoding;
+        std::string            m_held;
+    };
+
+    // turns bytes of whole code units into native code units and back, swapping them if the byte order is not the native one
+    // (the library only swaps bytes as it loads them for a conversion, this is the byte order change alone)
+    template <typename char_type>
+    class code_units_t {
+    public:
+        explicit code_units_t(bool little_endian)
+            : m_swap(little_endian != (utf::conversion::native_byte_order == utf::conversion::byte_order_e::little_endian)) {
+        }
+
+        // returns the code units of the bytes, copied into units so they are aligned
+        std::basic_string_view<char_type> decode(std::string_view bytes, std::basic_string<char_type>& units) {
+            units.resize(bytes.size() / sizeof(char_type));
+            std::memcpy(units.data(), bytes.data(), units.size() * sizeof(char_type));
+            if (m_swap) {
+                for (char_type& unit : units) {
+                    unit = swap_bytes(unit);
+                }
+            }
+            return units;
+        }
+
+        bool encode(const std::basic_string_view<char_type>& units, output_t& output) {
+            if (!m_swap) {
+                return output.write(units.data(), units.size() * sizeof(char_type));
+            }
+            m_swapped.resize(units.size());
+            for (std::size_t i = 0; i < units.size(); i++) {
+                m_swapped[i] = swap_bytes(units[i]);
+            }
+            return output.write(m_swapped.data(), m_swapped.size() * sizeof(char_type));
+        }
+
+    private:
+        bool                         m_swap;
+        std::basic_string<char_type> m_swapped;
+    };
+
+    // UTF-8 needs neither alignment nor swapping, so the piece (of the mapped file itself, if it is mapped) is used as it is
+    template <>
+    class code_units_t<char8_t> {
+    public:
+        explicit code_units_t(bool) {
+        }
+
+        std::basic_string_view<char8_t> decode(std::string_view bytes, std::basic_string<char8_t>&) {
+            return std::basic_string_view<char8_t>(reinterpret_cast<const char8_t*>(bytes.data()), bytes.size());
+        }
+
+        bool encode(const std::basic_string_view<char8_t>& units, output_t& output) {
+            return output.write(units.data(), units.size());
+        }
+    };
+
+    const char* status_name(utf::conversion::status_e status) {
+        switch (status) {
+        case utf::conversion::status_e::non_standard_encoding: return "the input is not standard-compliant";
+        case utf::conversion::status_e::output_too_small:      return "the output is too small";
+        default:                                               return "the input is malformed";
+        }
+    }
+
+    struct options_t {
+        encoding_e  from                 = encoding_e::utf8;
+        encoding_e  to                   = encoding_e::utf8;
+        bool        from_given           = false;
+        bool        to_given             = false;
+        bool        add_bom              = false;
+        bool        strip_bom            = false;
+        bool        comply_with_standard = false;
+        const char* input_path           = nullptr;
+        const char* output_path          = nullptr;
+    };
+
+    template <typename char_type>
+    utf::conversion::status_e validate(const std::basic_string_view<char_type>& units, bool comply_with_standard) {
+        if constexpr (sizeof(char_type) == sizeof(char8_t)) {
+            return utf::validate_utf8(units, comply_with_standard).status;
+        }
+        else if constexpr (sizeof(char_type) == sizeof(char16_t)) {
+            return utf::validate_utf16(units, comply_with_standard).status;
+        }
+        else {
+            return utf::validate_utf32(units, comply_with_standard).status;
+        }
+    }
+
+    // converts a piece of the input; UTF-16 and UTF-32 go through the byte stream overloads, which swap bytes as they load them
+    template <typename from_type, typename to_type>
+    utf::conversion::status_e convert(std::string_view bytes, const encoding_info_t& from, std::basic_string<to_type>& out, bool comply_with_standard) {
+        using namespace utf::conversion;
+
+        const byte_order_e byte_order = from.little_endian ? byte_order_e::little_endian : byte_order_e::big_endian;
+        if constexpr (sizeof(from_type) == sizeof(char8_t)) {
+            const std::basic_string_view<char8_t> units(reinterpret_cast<const char8_t*>(bytes.data()), bytes.size());
+            if constexpr (sizeof(to_type) == sizeof(char16_t)) {
+                return utf8_to_utf16(units, out, comply_with_standard);
+            }
+            else {
+                return utf8_to_utf32(units, out, comply_with_standard);
+            }
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char16_t) && sizeof(to_type) == sizeof(char8_t)) {
+            return utf16_to_utf8(bytes, byte_order, out, comply_with_standard);
+        }
+        else if constexpr (sizeof(from_type) == sizeof(char16_t)) {
+            return utf16_to_utf32(bytes, byte_order, out, comply_with_standard);
+        }
+        else if constexpr (sizeof(to_type) == sizeof(char8_t)) {
+            return utf32_to_utf8(bytes, byte_order, out, comply_with_standard);
+        }
+        else {
+            return utf32_to_utf16(bytes, byte_order, out, comply_with_standard);
+        }
+    }
+
+    // converts the input chunk by chunk, starting with the given one
+    template <typename from_type, typename to_type>
+    int transcode(input_t& input, std::string_view chunk, const options_t& options, output_t& output) {
+        const encoding_info_t&  from = info(options.from);
+        pieces_t                pieces(from);
+        code_units_t<from_type> from_units(from.little_endian);
+        code_units_t<to_type>   to_units(info(options.to).little_endian);
+
+        std::basic_string<from_type> decoded;
+        std::basic_string<to_type>   converted;
+        utf::conversion::status_e    status = utf::conversion::status_e::success;
+
+        const auto process = [&](std::string_view bytes) {
+            bool written = false;
+            if constexpr (sizeof(from_type) == sizeof(to_type)) {
+                // only the byte order changes, still the input has to be valid
+                const std::basic_string_view<from_type> units = from_units.decode(bytes, decoded);
+                status  = validate(units, options.comply_with_standard);
+                written = status != utf::conversion::status_e::success || to_units.encode(units, output);
+            }
+            else {
+                status  = convert<from_type, to_type>(bytes, from, converted, options.comply_with_standard);
+                written = status != utf::conversion::status_e::success || to_units.encode(converted, output);
+            }
+            if (!written) {
+                std::fprintf(stderr, "utf-convert: can not write to %s\n", options.output_path);
+                return false;
+            }
+            return status == utf::conversion::status_e::success;
+        };
+
+        bool processed = true;
+        for (; processed && !chunk.empty(); chunk = input.next()) {
+            processed = pieces.split(chunk, process);
+        }
+        if (processed && !pieces.truncated() && !pieces.held().empty()) {
+            processed = process(pieces.held());
+        }
+        if (!processed && status == utf::conversion::status_e::success) {
+            return 1;
+        }
+        if (status != utf::conversion::status_e::success) {
+            std::fprintf(stderr, "utf-convert: %s, the output is incomplete\n", status_name(status));
+            return 1;
+        }
+
+        if (input.failed()) {
+            std::fprintf(stderr, "utf-convert: can not read %s\n", options.input_path);
+            return 1;
+        }
+        if (pieces.truncated()) {
+            std::fprintf(stderr, "utf-convert: the input ends in the middle of a code unit\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    template <typename from_type>
+    int transcode_from(input_t& input, std::string_view chunk, const options_t& options, output_t& output) {
+        switch (info(options.to).unit_size) {
+        case sizeof(char8_t):  return transcode<from_type, char8_t>(input, chunk, options, output);
+        case sizeof(char16_t): return transcode<from_type, char16_t>(input, chunk, options, output);
+        default:               return transcode<from_type, char32_t>(input, chunk, options, output);
+        }
+    }
+
+    void print_usage() {
+        std::fprintf(stderr,
+            "usage: utf-convert [--from ENCODING] --to ENCODING [--add-bom | --strip-bom] [--strict] INPUT OUTPUT\n"
+            "  ENCODING is one of utf-8, utf-16le, utf-16be, utf-32le, utf-32be.\n"
+            "  Without --from the encoding is detected from the BOM, UTF-8 is assumed if there is none.\n"
+            "  The output gets a BOM if the input has one, unless --add-bom or --strip-bom is given.\n"
+            "  --strict rejects unpaired surrogates. INPUT and OUTPUT may be \"-\" for standard input and output.\n");
+    }
+
+    bool parse_options(int argc, char** argv, options_t& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view argument = argv[i];
+            if ((argument == "--from" || argument == "--to") && i + 1 < argc) {
+                const bool from = argument == "--from";
+                if (!parse_encoding(argv[++i], from ? options.from : options.to)) {
+                    std::fprintf(stderr, "utf-convert: unknown encoding %s\n", argv[i]);
+                    return false;
+                }
+                (from ? options.from_given : options.to_given) = true;
+            }
+            else if (argument == "--add-bom") {
+                options.add_bom = true;
+            }
+            else if (argument == "--strip-bom") {
+                options.strip_bom = true;
+            }
+            else if (argument == "--strict") {
+                options.comply_with_standard = true;
+            }
+            else if (argument.size() > 1 && argument[0] == '-') {
+                return false;
+            }
+            else if (options.input_path == nullptr) {
+                options.input_path = argv[i];
+            }
+            else if (options.output_path == nullptr) {
+                options.output_path = argv[i];
+            }
+            else {
+                return false;
+            }
+        }
+        return options.to_given && options.output_path != nullptr && !(options.add_bom && options.strip_bom);
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    options_t options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    input_t input;
+    if (!input.open(options.input_path)) {
+        std::fprintf(stderr, "utf-convert: can not open %s\n", options.input_path);
+        return 1;
+    }
+    output_t output;
+    if (!output.open(options.output_path)) {
+        std::fprintf(stderr, "utf-convert: can not create %s\n", options.output_path);
+        return 1;
+    }
+
+    // the BOM tells the encoding unless it is given, in which case only its own BOM is recognized
+    std::string_view chunk = input.next();
+    const encoding_info_t* bom = detect_bom(chunk);
+    if (options.from_given) {
+        const encoding_info_t& from = info(options.from);
+        bom = chunk.substr(0, from.bom_size) == std::string_view(from.bom, from.bom_size) ? &from : nullptr;
+    }
+    if (bom != nullptr) {
+        options.from = bom->encoding;
+        chunk.remove_prefix(bom->bom_size);
+    }
+
+    const bool write_bom = options.add_bom || (bom != nullptr && !options.strip_bom);
+    if (write_bom && !output.write(info(options.to).bom, info(options.to).bom_size)) {
+        std::fprintf(stderr, "utf-convert: can not write to %s\n", options.output_path);
+        return 1;
+    }
+
+    int result = 0;
+    switch (info(options.from).unit_size) {
+    case sizeof(char8_t):  result = transcode_from<char8_t>(input, chunk, options, output); break;
+    case sizeof(char16_t): result = transcode_from<char16_t>(input, chunk, options, output); break;
+    default:               result = transcode_from<char32_t>(input, chunk, options, output); break;
+    }
+
+    if (!output.close() && result == 0) {
+        std::fprintf(stderr, "utf-convert: can not write to %s\n", options.output_path);
+        return 1;
+    }
+    return result;
+}